@@ -0,0 +1,384 @@
+#include "bench.hpp"
+#include "perf_counter.hpp"
+#include "../Common/parallel.hpp"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+namespace bench
+{
+namespace
+{
+// Roots of a CSF tree a thread takes at once in MTTKRP
+const uint64_t ROOT_CHUNK = 16;
+
+// Deterministic value in [0, 1) of an entry, the same for every run & labeling
+double entry_value(uint64_t mode, uint64_t index, uint64_t column) {
+	uint64_t x = (mode << 56) ^ (index << 16) ^ column;
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+vector<uint> root_order(uint dimension, uint mode) { // <mode> first, MTTKRP on CSF
+	vector<uint> order(1, mode);
+	for (uint i = 0; i < dimension; i++) {
+		if (i != mode) {
+			order.push_back(i);
+		}
+	}
+	return order;
+}
+
+vector<uint> leaf_order(uint dimension, uint mode) { // <mode> last, TTV
+	vector<uint> order;
+	for (uint i = 0; i < dimension; i++) {
+		if (i != mode) {
+			order.push_back(i);
+		}
+	}
+	order.push_back(mode);
+	return order;
+}
+}
+
+string kernel_name(Kernel kernel) {
+	return kernel == MTTKRP ? "mttkrp" : "ttv";
+}
+
+string storage_name(Storage storage) {
+	return storage == COO ? "coo" : "csf";
+}
+
+// Class KernelBench
+
+KernelBench::KernelBench(const tensor::CooTensor & coo, const vector< vector<uint> > * relabeling, const string & labeling, uint rank)
+	: coo(coo), relabeling(relabeling), labeling(labeling), rank(rank) {
+	const uint dimension = coo.dimension();
+	if (dimension < 2) {
+		throw tensor::TensorException("Kernels need a tensor with at least 2 modes");
+	}
+	if (relabeling != nullptr && relabeling->size() != dimension) {
+		throw tensor::TensorException("Relabeling must have one table per mode of the tensor");
+	}
+
+	// 1 - Widths cover every coordinate, the original index of every row fills the operands
+	widths.resize(dimension);
+	factors.resize(dimension);
+	vectors.resize(dimension);
+	for (uint mode = 0; mode < dimension; mode++) {
+		vector<uint> original_index;
+		if (relabeling != nullptr) {
+			const vector<uint> & table = (*relabeling)[mode];
+			widths[mode] = table.size();
+			original_index.resize(table.size());
+			for (uint i = 0; i < table.size(); i++) {
+				original_index[table[i]] = i;
+			}
+		}
+		else {
+			const uint * coordinates = coo.coordinates(mode);
+			uint width = mode < coo.mode_widths().size() ? coo.mode_widths()[mode] : 0;
+			for (uint64_t i = 0; i < coo.nnz(); i++) {
+				width = max(width, coordinates[i] + 1);
+			}
+			widths[mode] = width;
+			original_index.resize(width);
+			for (uint i = 0; i < width; i++) {
+				original_index[i] = i;
+			}
+		}
+
+		factors[mode].resize(static_cast<uint64_t>(widths[mode]) * rank);
+		vectors[mode].resize(widths[mode]);
+		for (uint i = 0; i < widths[mode]; i++) {
+			for (uint r = 0; r < rank; r++) {
+				factors[mode][static_cast<uint64_t>(i) * rank + r] = entry_value(mode, original_index[i], r);
+			}
+			vectors[mode][i] = entry_value(mode, original_index[i], rank);
+		}
+	}
+}
+
+KernelResult KernelBench::run(Kernel kernel, Storage storage, uint mode, uint num_threads, uint iterations) {
+	const uint dimension = widths.size();
+	if (mode >= dimension) {
+		throw tensor::TensorException("Kernel mode exceeds the tensor dimension");
+	}
+
+	// 1 - Everything the kernel reads is built before the clock starts
+	vector<double> output;
+	vector<uint64_t> thread_begin, thread_fiber, thread_row;
+	if (kernel == MTTKRP && storage == COO) {
+		// nonzeros sorted by the output mode, every thread starts at a row of its own
+		const CooLayout & sorted = coo_layout(root_order(dimension, mode), num_threads);
+		const vector<uint> & rows = sorted.coordinates[mode];
+		const uint64_t nnz = sorted.values.size();
+		output.resize(static_cast<uint64_t>(widths[mode]) * rank);
+		for (uint thread_id = 0; thread_id <= num_threads; thread_id++) {
+			uint64_t i = nnz * thread_id / num_threads;
+			while (i != 0 && i < nnz && rows[i] == rows[i - 1]) {
+				i++;
+			}
+			thread_begin.push_back(i);
+			thread_row.push_back(thread_id == 0 ? 0 : i == nnz ? widths[mode] : rows[i]);
+		}
+	}
+	else if (kernel == MTTKRP) {
+		csf_tree(root_order(dimension, mode), num_threads);
+		output.resize(static_cast<uint64_t>(widths[mode]) * rank);
+	}
+	else {
+		// TTV writes one value per fiber of <mode>, every thread starts at a fiber of its own
+		const tensor::CsfTensor & fibers = csf_tree(leaf_order(dimension, mode), num_threads);
+		output.resize(fibers.node_count(dimension - 2));
+		if (storage == COO) {
+			coo_layout(leaf_order(dimension, mode), num_threads);
+			const uint64_t * fiber_pointers = fibers.fiber_pointers(dimension - 2);
+			const uint64_t fiber_count = fibers.node_count(dimension - 2);
+			for (uint thread_id = 0; thread_id <= num_threads; thread_id++) {
+				const uint64_t fiber = fiber_count * thread_id / num_threads;
+				thread_fiber.push_back(fiber);
+				thread_begin.push_back(fiber_pointers[fiber]);
+			}
+		}
+	}
+
+	// 2 - Timed iterations, run by one team of threads so no iteration pays for starting them. A barrier ends
+	// every iteration, the first one warms up. The CSF MTTKRP takes its roots from counter <i % 2> in iteration i,
+	// thread 0 resets the other counter once the iteration before has ended
+	PerfCounter counter;
+	common::Barrier barrier(num_threads);
+	atomic<uint64_t> next_root[2];
+	next_root[0].store(0);
+	chrono::high_resolution_clock::time_point begin, end;
+	int64_t cache_misses = -1;
+	common::run_threads(num_threads, [&](uint thread_id) {
+		for (uint i = 0; i <= iterations; i++) {
+			if (thread_id == 0) {
+				next_root[(i + 1) % 2].store(0);
+			}
+			if (kernel == MTTKRP) {
+				storage == COO ? mttkrp_coo(mode, thread_id, thread_begin, thread_row, output)
+					: mttkrp_csf(next_root[i % 2], output);
+			}
+			else {
+				storage == COO ? ttv_coo(mode, thread_id, thread_begin, thread_fiber, output)
+					: ttv_csf(mode, thread_id, num_threads, output);
+			}
+			barrier.wait();
+			if (i == 0) {
+				if (thread_id == 0) {
+					counter.start();
+					begin = chrono::high_resolution_clock::now();
+				}
+				barrier.wait();
+			}
+		}
+		if (thread_id == 0) {
+			end = chrono::high_resolution_clock::now();
+			cache_misses = counter.stop();
+		}
+	});
+	const double seconds = chrono::duration<double>(end - begin).count();
+
+	// 3 - MTTKRP does <dimension - 1> multiplications & one addition per nonzero & column, TTV one of each per nonzero
+	KernelResult result;
+	result.labeling = labeling;
+	result.kernel = kernel;
+	result.storage = storage;
+	result.mode = mode;
+	result.rank = kernel == MTTKRP ? rank : 1;
+	result.num_threads = num_threads;
+	result.iterations = iterations;
+	result.ms_per_iteration = iterations == 0 ? 0 : seconds * 1000 / iterations;
+	const double flops = kernel == MTTKRP ? static_cast<double>(coo.nnz()) * rank * dimension : 2.0 * coo.nnz();
+	result.gflops = seconds == 0 ? 0 : flops * iterations / seconds / 1e9;
+	result.cache_misses = cache_misses < 0 || iterations == 0 ? -1 : cache_misses / iterations;
+	result.checksum = 0;
+	for (uint64_t i = 0; i < output.size(); i++) {
+		result.checksum += output[i];
+	}
+	return result;
+}
+
+// Class KernelBench | Private Member Function Definitions
+
+const tensor::CsfTensor & KernelBench::csf_tree(const vector<uint> & order, uint num_threads) {
+	if (!tree || tree->mode_order() != order) {
+		tree.reset();
+		tree.reset(new tensor::CsfTensor(coo, order, num_threads, relabeling));
+		if (tree->values() != nullptr) {
+			tree_values.assign(tree->values(), tree->values() + tree->nnz());
+		}
+		else {
+			tree_values.assign(tree->nnz(), 1.0);
+		}
+	}
+	return *tree;
+}
+
+const KernelBench::CooLayout & KernelBench::coo_layout(const vector<uint> & order, uint num_threads) {
+	if (layout.order == order) {
+		return layout;
+	}
+	// the leaves of the CSF tree of the same order are the sorted nonzeros, every level is expanded down to them
+	const tensor::CsfTensor & sorted = csf_tree(order, num_threads);
+	const uint dimension = order.size();
+	const uint64_t nnz = sorted.nnz();
+	layout.order = order;
+	layout.coordinates.assign(dimension, vector<uint>());
+	layout.values = tree_values;
+	vector<uint64_t> first_leaf(nnz + 1), next_first_leaf;
+	for (uint64_t i = 0; i <= nnz; i++) {
+		first_leaf[i] = i;
+	}
+	for (int level = dimension - 1; level >= 0; level--) {
+		vector<uint> & coordinates = layout.coordinates[order[level]];
+		coordinates.resize(nnz);
+		const uint * ids = sorted.fiber_ids(level);
+		const uint64_t nodes = sorted.node_count(level);
+		// first_leaf[n] is the first leaf under node n of this level
+		if (level != static_cast<int>(dimension) - 1) {
+			const uint64_t * pointers = sorted.fiber_pointers(level);
+			next_first_leaf.resize(nodes + 1);
+			for (uint64_t node = 0; node <= nodes; node++) {
+				next_first_leaf[node] = first_leaf[pointers[node]];
+			}
+			first_leaf.swap(next_first_leaf);
+		}
+		for (uint64_t node = 0; node < nodes; node++) {
+			fill(coordinates.begin() + first_leaf[node], coordinates.begin() + first_leaf[node + 1], ids[node]);
+		}
+	}
+	return layout;
+}
+
+void KernelBench::mttkrp_coo(uint mode, uint thread_id, const vector<uint64_t> & thread_begin,
+	const vector<uint64_t> & thread_row, vector<double> & output) const {
+	// Nonzeros are sorted by the output mode and a thread starts at a row of its own, so threads write disjoint rows
+	const uint dimension = widths.size();
+	fill(output.begin() + thread_row[thread_id] * rank, output.begin() + thread_row[thread_id + 1] * rank, 0.0);
+	vector<double> row(rank);
+	for (uint64_t i = thread_begin[thread_id]; i < thread_begin[thread_id + 1]; i++) {
+		for (uint r = 0; r < rank; r++) {
+			row[r] = layout.values[i];
+		}
+		for (uint m = 0; m < dimension; m++) {
+			if (m != mode) {
+				const double * factor_row = &factors[m][static_cast<uint64_t>(layout.coordinates[m][i]) * rank];
+				for (uint r = 0; r < rank; r++) {
+					row[r] *= factor_row[r];
+				}
+			}
+		}
+		double * output_row = &output[static_cast<uint64_t>(layout.coordinates[mode][i]) * rank];
+		for (uint r = 0; r < rank; r++) {
+			output_row[r] += row[r];
+		}
+	}
+}
+
+void KernelBench::mttkrp_csf(atomic<uint64_t> & next_root, vector<double> & output) const {
+	// Roots are the rows of the output, so threads taking whole roots never write the same row [rows without
+	// a root stay zero]. Below the root every node multiplies the sum of its children by its own factor row
+	const tensor::CsfTensor & csf = *tree;
+	const uint dimension = csf.dimension();
+	const vector<uint> & order = csf.mode_order();
+	const uint64_t roots = csf.node_count(0);
+	vector<double> partial(static_cast<size_t>(dimension) * rank);
+	// adds the contribution of <node> of <level> into <sum>
+	function<void(uint, uint64_t, double *)> accumulate = [&](uint level, uint64_t node, double * sum) {
+		const double * factor_row = &factors[order[level]][static_cast<uint64_t>(csf.fiber_ids(level)[node]) * rank];
+		if (level + 1 == dimension) {
+			const double value = tree_values[node];
+			for (uint r = 0; r < rank; r++) {
+				sum[r] += value * factor_row[r];
+			}
+			return;
+		}
+		double * children = &partial[static_cast<size_t>(level) * rank];
+		fill(children, children + rank, 0.0);
+		const uint64_t * pointers = csf.fiber_pointers(level);
+		if (level + 2 == dimension) { // leaves, no call per nonzero
+			const uint * leaf_ids = csf.fiber_ids(level + 1);
+			const vector<double> & leaf_factor = factors[order[level + 1]];
+			for (uint64_t leaf = pointers[node]; leaf < pointers[node + 1]; leaf++) {
+				const double value = tree_values[leaf];
+				const double * leaf_row = &leaf_factor[static_cast<uint64_t>(leaf_ids[leaf]) * rank];
+				for (uint r = 0; r < rank; r++) {
+					children[r] += value * leaf_row[r];
+				}
+			}
+		}
+		else {
+			for (uint64_t child = pointers[node]; child < pointers[node + 1]; child++) {
+				accumulate(level + 1, child, children);
+			}
+		}
+		for (uint r = 0; r < rank; r++) {
+			sum[r] += children[r] * factor_row[r];
+		}
+	};
+
+	const uint64_t * root_pointers = csf.fiber_pointers(0);
+	for (uint64_t first = next_root.fetch_add(ROOT_CHUNK); first < roots; first = next_root.fetch_add(ROOT_CHUNK)) {
+		const uint64_t last = min(first + ROOT_CHUNK, roots);
+		for (uint64_t root = first; root < last; root++) {
+			double * output_row = &output[static_cast<uint64_t>(csf.fiber_ids(0)[root]) * rank];
+			fill(output_row, output_row + rank, 0.0);
+			for (uint64_t child = root_pointers[root]; child < root_pointers[root + 1]; child++) {
+				accumulate(1, child, output_row);
+			}
+		}
+	}
+}
+
+void KernelBench::ttv_coo(uint mode, uint thread_id, const vector<uint64_t> & thread_begin,
+	const vector<uint64_t> & thread_fiber, vector<double> & output) const {
+	// Nonzeros of a fiber are adjacent, a new fiber starts where any other mode changes
+	const uint dimension = widths.size();
+	const vector<double> & operand = vectors[mode];
+	const uint64_t begin = thread_begin[thread_id], end = thread_begin[thread_id + 1];
+	uint64_t fiber = thread_fiber[thread_id];
+	if (begin == end) {
+		return;
+	}
+	fill(output.begin() + thread_fiber[thread_id], output.begin() + thread_fiber[thread_id + 1], 0.0);
+	const uint * coordinates = layout.coordinates[mode].data();
+	for (uint64_t i = begin; i < end; i++) {
+		if (i != begin) {
+			for (uint m = 0; m < dimension; m++) {
+				if (m != mode && layout.coordinates[m][i] != layout.coordinates[m][i - 1]) {
+					fiber++;
+					break;
+				}
+			}
+		}
+		output[fiber] += layout.values[i] * operand[coordinates[i]];
+	}
+}
+
+void KernelBench::ttv_csf(uint mode, uint thread_id, uint num_threads, vector<double> & output) const {
+	const tensor::CsfTensor & csf = *tree;
+	const uint fiber_level = csf.dimension() - 2;
+	const uint64_t * fiber_pointers = csf.fiber_pointers(fiber_level);
+	const uint * leaf_ids = csf.fiber_ids(fiber_level + 1);
+	const vector<double> & operand = vectors[mode];
+	const uint64_t fibers = csf.node_count(fiber_level);
+	const uint64_t end = fibers * (thread_id + 1) / num_threads;
+	for (uint64_t fiber = fibers * thread_id / num_threads; fiber < end; fiber++) {
+		double sum = 0;
+		for (uint64_t leaf = fiber_pointers[fiber]; leaf < fiber_pointers[fiber + 1]; leaf++) {
+			sum += tree_values[leaf] * operand[leaf_ids[leaf]];
+		}
+		output[fiber] = sum;
+	}
+}
+}
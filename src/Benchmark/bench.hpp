@@ -0,0 +1,82 @@
+#ifndef _BENCH_HPP
+#define _BENCH_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "../Tensor/tensor.hpp"
+#include "../Tensor/csf.hpp"
+
+namespace bench
+{
+typedef unsigned int uint;
+
+enum Kernel { MTTKRP, TTV };
+enum Storage { COO, CSF };
+
+struct KernelResult {
+	std::string labeling;
+	Kernel kernel;
+	Storage storage;
+	uint mode;
+	uint rank; // 1 for TTV
+	uint num_threads;
+	uint iterations;
+	double ms_per_iteration;
+	double gflops;
+	int64_t cache_misses; // per iteration, -1 when perf_event isn't available
+	double checksum; // sum of the output, the same for every labeling of a tensor up to rounding
+};
+
+// One labeling of a tensor prepared for the kernels. The factor matrices [and the TTV vectors] are
+// filled from the original indices, so a relabeled tensor computes the same output in permuted order.
+// Every COO layout and CSF tree is built before the timed iterations, the last one is kept for the next run.
+// The iterations of a run share one team of threads
+class KernelBench {
+public:
+	// <relabeling> as Relabel::relabeling() returns it, nullptr for the natural labeling. <labeling> names it in the results
+	KernelBench(const tensor::CooTensor & coo, const std::vector< std::vector<uint> > * relabeling, const std::string & labeling, uint rank);
+
+	uint dimension() const { return widths.size(); }
+
+	// Runs the kernel once untimed, then <iterations> times
+	KernelResult run(Kernel kernel, Storage storage, uint mode, uint num_threads, uint iterations);
+private:
+	// nonzeros sorted by <order>, coordinates & values of one nonzero at the same index
+	struct CooLayout {
+		std::vector<uint> order;
+		std::vector< std::vector<uint> > coordinates; // [mode][nonzero]
+		std::vector<double> values;
+	};
+
+	const tensor::CooTensor & coo;
+	const std::vector< std::vector<uint> > * relabeling;
+	std::string labeling;
+	uint rank;
+	std::vector<uint> widths;
+	std::vector< std::vector<double> > factors; // [mode] widths[mode] x rank, row major
+	std::vector< std::vector<double> > vectors; // [mode] widths[mode], the TTV operands
+
+	std::unique_ptr<tensor::CsfTensor> tree;
+	std::vector<double> tree_values; // leaf values of <tree>, ones when the tensor has no values
+	CooLayout layout;
+
+	const tensor::CsfTensor & csf_tree(const std::vector<uint> & order, uint num_threads);
+	const CooLayout & coo_layout(const std::vector<uint> & order, uint num_threads);
+
+	// every kernel is the part of one iteration done by <thread_id>
+	void mttkrp_coo(uint mode, uint thread_id, const std::vector<uint64_t> & thread_begin,
+		const std::vector<uint64_t> & thread_row, std::vector<double> & output) const;
+	void mttkrp_csf(std::atomic<uint64_t> & next_root, std::vector<double> & output) const; // the tree is rooted at the output mode
+	void ttv_coo(uint mode, uint thread_id, const std::vector<uint64_t> & thread_begin,
+		const std::vector<uint64_t> & thread_fiber, std::vector<double> & output) const;
+	void ttv_csf(uint mode, uint thread_id, uint num_threads, std::vector<double> & output) const;
+};
+
+std::string kernel_name(Kernel kernel);
+std::string storage_name(Storage storage);
+}
+
+#endif
@@ -0,0 +1,239 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "bench.hpp"
+#include "../Tensor/tensor.hpp"
+#include "../RelabelTensor/relabel.hpp"
+#include "../Common/parallel.hpp"
+using namespace std;
+
+namespace bench
+{
+void usage() {
+	cout << "Usage: PURE bench TENSOR [-p PERMUTATION...] -[OPTIONS...]" << endl;
+}
+
+void help() {
+	cout << "Tensor kernel benchmark" << endl
+		<< "-----------------------" << endl
+		<< "Times MTTKRP & tensor-times-vector on the tensor in its natural labeling and relabeled by every" << endl
+		<< "permutation, the relabeled tensors are only built in memory" << endl;
+	usage();
+	cout << "Available options" << endl
+		<< "\t-p FILENAME\t\t permutation file [as rcm & rabbit write it], may be repeated" << endl
+		<< "\t-kernel NAME\t\t mttkrp, ttv or all [default]" << endl
+		<< "\t-storage NAME\t\t coo, csf or all [default]" << endl
+		<< "\t-mode M\t\t\t only runs the kernels of mode M [default: every mode]" << endl
+		<< "\t-rank R\t\t\t number of columns of the MTTKRP factor matrices [default: 16]" << endl
+		<< "\t-threads N[,N...]\t thread counts to run every kernel with" << endl
+		<< "\t-iterations K\t\t timed iterations of every kernel [default: 5]" << endl
+		<< "\t-o FILENAME\t\t also writes the results as csv" << endl
+		<< "\t-no_values \t\t tensor file does NOT contain values" << endl;
+}
+
+int benchMain(int argc, char * argv[]) {
+	cout << "************************************" << endl;
+	// 1 - parse the command line options
+	vector<string> arguments(argc);
+	for (int i = 0; i < argc; i++) {
+		arguments[i] = string(argv[i]);
+	}
+
+	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
+		help();
+		exit(0);
+	}
+	else if (argc < 2) {
+		usage();
+		exit(0);
+	}
+
+	bool values_exist = true;
+	uint rank = 16, iterations = 5;
+	int only_mode = -1;
+	string tensor_file, kernel_option = "all", storage_option = "all", output_file;
+	vector<string> permutation_files;
+	vector<uint> thread_counts;
+	for (int i = 1; i < argc; i++) {
+		if (arguments[i] == "-no_values") {
+			values_exist = false;
+		}
+		else if (arguments[i] == "-p" || arguments[i] == "-kernel" || arguments[i] == "-storage" || arguments[i] == "-mode"
+			|| arguments[i] == "-rank" || arguments[i] == "-threads" || arguments[i] == "-iterations" || arguments[i] == "-o") {
+			if (i + 1 >= argc || arguments[i + 1][0] == '-') {
+				cerr << "expected a value after " << arguments[i] << ", didn't find one!" << endl;
+				exit(1);
+			}
+			const string & value = arguments[++i];
+			if (arguments[i - 1] == "-p") {
+				permutation_files.push_back(value);
+			}
+			else if (arguments[i - 1] == "-kernel") {
+				kernel_option = value;
+			}
+			else if (arguments[i - 1] == "-storage") {
+				storage_option = value;
+			}
+			else if (arguments[i - 1] == "-mode") {
+				only_mode = atoi(value.c_str());
+			}
+			else if (arguments[i - 1] == "-rank") {
+				rank = atoi(value.c_str());
+			}
+			else if (arguments[i - 1] == "-iterations") {
+				iterations = atoi(value.c_str());
+			}
+			else if (arguments[i - 1] == "-o") {
+				output_file = value;
+			}
+			else {
+				istringstream counts(value);
+				string count;
+				while (getline(counts, count, ',')) {
+					thread_counts.push_back(atoi(count.c_str()));
+				}
+			}
+		}
+		else if (arguments[i][0] != '-' && tensor_file == "") {
+			tensor_file = arguments[i];
+		}
+		else { // unknown argument!
+			cerr << "Unknown argument encountered: " << arguments[i] << endl;
+			exit(1);
+		}
+	}
+
+	if (tensor_file == "") {
+		cerr << "A tensor file must be provided!" << endl;
+		exit(1);
+	}
+	if ((kernel_option != "mttkrp" && kernel_option != "ttv" && kernel_option != "all")
+		|| (storage_option != "coo" && storage_option != "csf" && storage_option != "all")) {
+		cerr << "Unknown kernel or storage, see PURE bench --help" << endl;
+		exit(1);
+	}
+	if (rank == 0) {
+		cerr << "The rank must be at least 1" << endl;
+		exit(1);
+	}
+	if (thread_counts.empty()) {
+		thread_counts.push_back(common::default_thread_count());
+	}
+	for (uint i = 0; i < thread_counts.size(); i++) {
+		if (thread_counts[i] == 0) {
+			cerr << "Thread counts must be at least 1" << endl;
+			exit(1);
+		}
+	}
+	vector<Kernel> kernels;
+	if (kernel_option != "ttv") {
+		kernels.push_back(MTTKRP);
+	}
+	if (kernel_option != "mttkrp") {
+		kernels.push_back(TTV);
+	}
+	vector<Storage> storages;
+	if (storage_option != "csf") {
+		storages.push_back(COO);
+	}
+	if (storage_option != "coo") {
+		storages.push_back(CSF);
+	}
+
+	// 2 - every labeling runs the same kernels, a permutation only changes the coordinates the layouts are built from
+	vector<KernelResult> results;
+	try {
+		tensor::CooTensor coo(tensor_file, values_exist, thread_counts.back());
+		if (only_mode >= static_cast<int>(coo.dimension())) {
+			cerr << "The tensor has only " << coo.dimension() << " modes" << endl;
+			exit(1);
+		}
+		cout << "Read " << coo.nnz() << " nonzeros from the tensor file" << endl;
+
+		for (uint labeling = 0; labeling <= permutation_files.size(); labeling++) {
+			vector< vector<uint> > relabeling;
+			string name = "natural";
+			if (labeling != 0) {
+				name = permutation_files[labeling - 1];
+				vector<uint> widths, labels;
+				relabel::read_permutation_file(name, widths, labels);
+				relabel::Relabel relabel_obj(labels, widths, false, thread_counts.back());
+				relabeling = relabel_obj.relabeling();
+				for (uint mode = 0; mode < relabeling.size() && mode < coo.dimension(); mode++) {
+					const uint * coordinates = coo.coordinates(mode);
+					if (coo.nnz() != 0 && *max_element(coordinates, coordinates + coo.nnz()) >= relabeling[mode].size()) {
+						cerr << "Permutation " << name << " doesn't fit the tensor" << endl;
+						exit(1);
+					}
+				}
+			}
+			KernelBench kernel_bench(coo, labeling == 0 ? nullptr : &relabeling, name, rank);
+			for (uint k = 0; k < kernels.size(); k++) {
+				for (uint mode = 0; mode < coo.dimension(); mode++) {
+					if (only_mode >= 0 && mode != static_cast<uint>(only_mode)) {
+						continue;
+					}
+					for (uint s = 0; s < storages.size(); s++) {
+						for (uint t = 0; t < thread_counts.size(); t++) {
+							results.push_back(kernel_bench.run(kernels[k], storages[s], mode, thread_counts[t], iterations));
+							const KernelResult & result = results.back();
+							cout << name << " " << kernel_name(result.kernel) << " " << storage_name(result.storage)
+								<< " mode " << mode << " threads " << result.num_threads << ": "
+								<< result.ms_per_iteration << " ms/iteration" << endl;
+						}
+					}
+				}
+			}
+		}
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot benchmark the tensor " << tensor_file << ": " << exc.what() << endl;
+		exit(1);
+	}
+
+	// 3 - results, the speedup compares every run to the same run on the natural labeling
+	const uint natural_runs = results.size() / (permutation_files.size() + 1);
+	cout << "------------------------------------" << endl
+		<< left << setw(20) << "labeling" << setw(8) << "kernel" << setw(8) << "storage" << setw(6) << "mode"
+		<< setw(6) << "rank" << setw(9) << "threads" << setw(14) << "ms/iteration" << setw(10) << "GFLOP/s"
+		<< setw(14) << "cache misses" << setw(10) << "speedup" << "checksum" << endl;
+	for (uint i = 0; i < results.size(); i++) {
+		const KernelResult & result = results[i];
+		const KernelResult & natural = results[i % natural_runs];
+		cout << left << setw(20) << result.labeling << setw(8) << kernel_name(result.kernel) << setw(8) << storage_name(result.storage)
+			<< setw(6) << result.mode << setw(6) << result.rank << setw(9) << result.num_threads
+			<< setw(14) << result.ms_per_iteration << setw(10) << result.gflops
+			<< setw(14) << (result.cache_misses < 0 ? string("n/a") : to_string(result.cache_misses))
+			<< setw(10) << (result.ms_per_iteration == 0 ? 0 : natural.ms_per_iteration / result.ms_per_iteration)
+			<< result.checksum << endl;
+	}
+
+	if (output_file != "") {
+		ofstream os(output_file);
+		if (!os.is_open()) {
+			cerr << "Cannot create the result file " << output_file << endl;
+			exit(1);
+		}
+		os << "labeling,kernel,storage,mode,rank,threads,iterations,ms_per_iteration,gflops,cache_misses,speedup,checksum" << endl;
+		os << setprecision(10);
+		for (uint i = 0; i < results.size(); i++) {
+			const KernelResult & result = results[i];
+			const KernelResult & natural = results[i % natural_runs];
+			os << result.labeling << "," << kernel_name(result.kernel) << "," << storage_name(result.storage) << ","
+				<< result.mode << "," << result.rank << "," << result.num_threads << "," << result.iterations << ","
+				<< result.ms_per_iteration << "," << result.gflops << ","
+				<< (result.cache_misses < 0 ? string("") : to_string(result.cache_misses)) << ","
+				<< (result.ms_per_iteration == 0 ? 0 : natural.ms_per_iteration / result.ms_per_iteration) << ","
+				<< result.checksum << endl;
+		}
+		cout << "Results have been written to " << output_file << endl;
+	}
+	cout << "************************************" << endl;
+	return 0;
+}
+}
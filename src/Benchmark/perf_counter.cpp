@@ -0,0 +1,61 @@
+#include "perf_counter.hpp"
+#include <cstring>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench
+{
+
+// Class PerfCounter
+
+PerfCounter::PerfCounter() : descriptor(-1) {
+#ifdef __linux__
+	perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = PERF_TYPE_HARDWARE;
+	attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+	attributes.disabled = 1;
+	attributes.inherit = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	descriptor = static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+}
+
+PerfCounter::~PerfCounter() {
+#ifdef __linux__
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+#endif
+}
+
+void PerfCounter::start() {
+#ifdef __linux__
+	if (descriptor >= 0) {
+		ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+		ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+int64_t PerfCounter::stop() {
+#ifdef __linux__
+	if (descriptor >= 0) {
+		ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+		uint64_t count = 0;
+		if (read(descriptor, &count, sizeof(count)) == sizeof(count)) {
+			return static_cast<int64_t>(count);
+		}
+	}
+#endif
+	return -1;
+}
+}
@@ -0,0 +1,28 @@
+#ifndef _PERF_COUNTER_HPP
+#define _PERF_COUNTER_HPP
+
+#include <cstdint>
+
+namespace bench
+{
+// Hardware cache miss counter of this process through perf_event [linux only]. Threads started after
+// the counter is created inherit it, start() & stop() reach them too, so run_threads() work is fully covered.
+// When the kernel doesn't allow the counter [perf_event_paranoid, containers, other systems]
+// available() is false and stop() returns -1
+class PerfCounter {
+public:
+	PerfCounter();
+	~PerfCounter();
+
+	bool available() const { return descriptor >= 0; }
+	void start();
+	int64_t stop(); // cache misses since start()
+private:
+	PerfCounter(const PerfCounter &);
+	PerfCounter & operator=(const PerfCounter &);
+
+	int descriptor;
+};
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _BINARY_FILE_HPP
+#define _BINARY_FILE_HPP
+
+#include <cstdint>
+#include <ostream>
+
+// Helpers of the binary containers [tensor & graph], their sections start at 8 byte aligned offsets
+// so the arrays of a mapped file can be used directly
+namespace common
+{
+inline uint64_t aligned(uint64_t bytes) {
+	return (bytes + 7) & ~static_cast<uint64_t>(7);
+}
+
+inline void write_padded(std::ostream & os, const void * data, uint64_t bytes) {
+	static const char padding[8] = { 0 };
+	os.write(static_cast<const char *>(data), bytes);
+	os.write(padding, aligned(bytes) - bytes);
+}
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include "mapped_file.hpp"
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+namespace common
+{
+MappedFile::MappedFile(const string & filename) : begin(nullptr), length(0) {
+	const int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw MappedFileException("Cannot open the input file");
+	}
+
+	struct stat file_info;
+	if (fstat(fd, &file_info) != 0) {
+		close(fd);
+		throw MappedFileException("Cannot read the size of the input file");
+	}
+	length = file_info.st_size;
+
+	// mmap rejects empty mappings, an empty file is represented by a null range
+	if (length > 0) {
+		void * address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED) {
+			close(fd);
+			throw MappedFileException("Cannot map the input file into memory");
+		}
+		madvise(address, length, MADV_SEQUENTIAL);
+		begin = static_cast<const char *>(address);
+	}
+	close(fd); // the mapping stays valid after the descriptor is closed
+}
+
+MappedFile::~MappedFile() {
+	if (begin != nullptr) {
+		munmap(const_cast<char *>(begin), length);
+	}
+}
+}
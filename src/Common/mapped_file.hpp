@@ -0,0 +1,42 @@
+#ifndef _MAPPED_FILE_HPP
+#define _MAPPED_FILE_HPP
+
+#include <string>
+#include <exception>
+#include <cstddef>
+
+namespace common
+{
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+	explicit MappedFile(const std::string & filename);
+	~MappedFile();
+
+	const char * data() const { return begin; }
+	std::size_t size() const { return length; }
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const char * begin;
+	std::size_t length;
+};
+
+// =====================
+// EXCEPTION CLASS BELOW
+// =====================
+
+class MappedFileException : public std::exception {
+public:
+	MappedFileException(const char * msg) : msg(msg) { }
+
+	const char * what() const noexcept {
+		return msg;
+	}
+private:
+	const char * msg;
+};
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _PARALLEL_HPP
+#define _PARALLEL_HPP
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+namespace common
+{
+typedef unsigned int uint;
+
+// Returns the number of worker threads to use when the caller didn't request a specific count
+inline uint default_thread_count() {
+	const uint hardware_threads = std::thread::hardware_concurrency();
+	return hardware_threads == 0 ? 1 : hardware_threads;
+}
+
+// Runs <task(thread_id)> on <num_threads> threads and waits for all of them to finish
+// Thread 0 is the calling thread, so a single threaded run doesn't spawn anything
+template <typename Task>
+void run_threads(uint num_threads, Task task) {
+	if (num_threads <= 1) {
+		task(0);
+		return;
+	}
+	std::vector<std::thread> workers;
+	workers.reserve(num_threads - 1);
+	for (uint thread_id = 1; thread_id < num_threads; thread_id++) {
+		workers.push_back(std::thread(task, thread_id));
+	}
+	task(0);
+	for (uint i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+// Reusable barrier for the threads of one run_threads() call, used to separate the phases of an algorithm
+class Barrier {
+public:
+	explicit Barrier(uint num_threads) : num_threads(num_threads), waiting(0), generation(0) { }
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		const uint arrival_generation = generation;
+		if (++waiting == num_threads) {
+			waiting = 0;
+			generation++;
+			condition.notify_all();
+		}
+		else {
+			condition.wait(lock, [&] { return generation != arrival_generation; });
+		}
+	}
+private:
+	Barrier(const Barrier &);
+	Barrier & operator=(const Barrier &);
+
+	const uint num_threads;
+	uint waiting;
+	uint generation;
+	std::mutex mutex;
+	std::condition_variable condition;
+};
+
+// Splits [0, count) into <num_threads> contiguous blocks and calls <body(begin, end, thread_id)> for each
+template <typename Body>
+void parallel_blocks(uint64_t count, uint num_threads, Body body) {
+	if (num_threads == 0) {
+		num_threads = default_thread_count();
+	}
+	if (count < num_threads) {
+		num_threads = count == 0 ? 1 : static_cast<uint>(count);
+	}
+	run_threads(num_threads, [&](uint thread_id) {
+		const uint64_t begin = count * thread_id / num_threads;
+		const uint64_t end = count * (thread_id + 1) / num_threads;
+		body(begin, end, thread_id);
+	});
+}
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef _RADIX_SORT_HPP
+#define _RADIX_SORT_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "parallel.hpp"
+
+namespace common
+{
+namespace radix
+{
+const uint DIGIT_BITS = 8;
+const uint BUCKETS = 1 << DIGIT_BITS;
+const uint64_t MIN_KEYS_PER_THREAD = 1 << 16; // smaller blocks cost more in thread start up than they save
+}
+
+// Number of bits needed to store every value in [0, max_value]
+inline uint bits_for(uint64_t max_value) {
+	uint bits = 0;
+	while (bits < 64 && (max_value >> bits) != 0) {
+		bits++;
+	}
+	return bits;
+}
+
+// Stable LSD radix sort of <count> keys on their lowest <key_bits> bits, <payloads[i]> moves along
+// with <keys[i]> [payloads may be nullptr]. A pass sorts 8 bits, so narrow keys take fewer passes.
+// Each thread counts the digits of its block, the blocks are then scattered in order which keeps the sort stable
+template <typename Payload>
+void radix_sort(uint64_t * keys, Payload * payloads, uint64_t count, uint key_bits, uint num_threads = 0) {
+	if (num_threads == 0) {
+		num_threads = default_thread_count();
+	}
+	num_threads = static_cast<uint>(std::max<uint64_t>(1, std::min<uint64_t>(num_threads, count / radix::MIN_KEYS_PER_THREAD)));
+
+	std::vector<uint64_t> key_buffer(count);
+	std::vector<Payload> payload_buffer(payloads != nullptr ? count : 0);
+	uint64_t * source_keys = keys, * target_keys = key_buffer.data();
+	Payload * source_payloads = payloads, * target_payloads = payloads != nullptr ? payload_buffer.data() : nullptr;
+	std::vector<uint64_t> positions(static_cast<size_t>(num_threads) * radix::BUCKETS);
+
+	for (uint shift = 0; shift < key_bits; shift += radix::DIGIT_BITS) {
+		// 1 - Digit histogram of every block
+		std::fill(positions.begin(), positions.end(), 0);
+		run_threads(num_threads, [&](uint thread_id) {
+			uint64_t * histogram = &positions[static_cast<size_t>(thread_id) * radix::BUCKETS];
+			const uint64_t end = count * (thread_id + 1) / num_threads;
+			for (uint64_t i = count * thread_id / num_threads; i < end; i++) {
+				histogram[(source_keys[i] >> shift) & (radix::BUCKETS - 1)]++;
+			}
+		});
+
+		// 2 - Where every block starts writing each digit, a pass with a single digit moves nothing
+		bool single_digit = false;
+		uint64_t offset = 0;
+		for (uint digit = 0; digit < radix::BUCKETS; digit++) {
+			const uint64_t digit_begin = offset;
+			for (uint thread_id = 0; thread_id < num_threads; thread_id++) {
+				uint64_t & position = positions[static_cast<size_t>(thread_id) * radix::BUCKETS + digit];
+				const uint64_t digit_count = position;
+				position = offset;
+				offset += digit_count;
+			}
+			single_digit = single_digit || offset - digit_begin == count;
+		}
+		if (single_digit) {
+			continue;
+		}
+
+		// 3 - Scatter
+		run_threads(num_threads, [&](uint thread_id) {
+			uint64_t * position = &positions[static_cast<size_t>(thread_id) * radix::BUCKETS];
+			const uint64_t end = count * (thread_id + 1) / num_threads;
+			for (uint64_t i = count * thread_id / num_threads; i < end; i++) {
+				const uint64_t target = position[(source_keys[i] >> shift) & (radix::BUCKETS - 1)]++;
+				target_keys[target] = source_keys[i];
+				if (source_payloads != nullptr) {
+					target_payloads[target] = source_payloads[i];
+				}
+			}
+		});
+		std::swap(source_keys, target_keys);
+		std::swap(source_payloads, target_payloads);
+	}
+
+	if (source_keys != keys) {
+		std::copy(source_keys, source_keys + count, keys);
+		if (payloads != nullptr) {
+			std::copy(source_payloads, source_payloads + count, payloads);
+		}
+	}
+}
+
+template <typename Payload>
+void radix_sort(std::vector<uint64_t> & keys, std::vector<Payload> & payloads, uint key_bits, uint num_threads = 0) {
+	radix_sort(keys.data(), payloads.data(), keys.size(), key_bits, num_threads);
+}
+
+inline void radix_sort(std::vector<uint64_t> & keys, uint key_bits, uint num_threads = 0) {
+	radix_sort(keys.data(), static_cast<uint *>(nullptr), keys.size(), key_bits, num_threads);
+}
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef _TEXT_PARSE_HPP
+#define _TEXT_PARSE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+
+// Minimal parsers for whitespace separated text held in memory [e.g. a MappedFile],
+// the input ranges are not null terminated so every function takes the end of the range.
+// format_uint is the matching writer for output buffers
+namespace common
+{
+inline bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char * skip_blanks(const char * position, const char * end) {
+	while (position != end && is_blank(*position)) {
+		position++;
+	}
+	return position;
+}
+
+// Returns the beginning of the line following the one <position> is on
+inline const char * next_line(const char * position, const char * end) {
+	const char * newline = static_cast<const char *>(memchr(position, '\n', end - position));
+	return newline == nullptr ? end : newline + 1;
+}
+
+// A record is a line that is neither blank nor a comment
+inline bool is_record(const char * line, const char * end) {
+	line = skip_blanks(line, end);
+	return line != end && *line != '\n' && *line != '%';
+}
+
+inline bool parse_uint(const char *& position, const char * end, uint64_t & result) {
+	position = skip_blanks(position, end);
+	if (position == end || *position < '0' || *position > '9') {
+		return false;
+	}
+	result = 0;
+	while (position != end && *position >= '0' && *position <= '9') {
+		result = result * 10 + (*position - '0');
+		position++;
+	}
+	return true;
+}
+
+inline bool parse_double(const char *& position, const char * end, double & result) {
+	static const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+		1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+	};
+
+	position = skip_blanks(position, end);
+	const char * token = position;
+
+	// Fast path: [sign] digits [. digits] with at most 15 significant digits and no exponent,
+	// the mantissa and the power of ten are exact so the division is correctly rounded
+	bool negative = false;
+	if (position != end && (*position == '-' || *position == '+')) {
+		negative = *position == '-';
+		position++;
+	}
+	uint64_t mantissa = 0;
+	int digits = 0, fraction_digits = 0;
+	while (position != end && *position >= '0' && *position <= '9') {
+		mantissa = mantissa * 10 + (*position - '0');
+		digits++;
+		position++;
+	}
+	if (position != end && *position == '.') {
+		position++;
+		while (position != end && *position >= '0' && *position <= '9') {
+			mantissa = mantissa * 10 + (*position - '0');
+			digits++;
+			fraction_digits++;
+			position++;
+		}
+	}
+	const bool token_ended = position == end || is_blank(*position) || *position == '\n';
+	if (digits > 0 && digits <= 15 && token_ended) {
+		result = static_cast<double>(mantissa) / powers_of_ten[fraction_digits];
+		if (negative) {
+			result = -result;
+		}
+		return true;
+	}
+
+	// Slow path: exponents, long mantissas, inf/nan; the token is copied since the mapping isn't null terminated
+	const char * token_end = token;
+	while (token_end != end && !is_blank(*token_end) && *token_end != '\n') {
+		token_end++;
+	}
+	if (token_end == token || token_end - token >= 64) {
+		return false;
+	}
+	char buffer[64];
+	memcpy(buffer, token, token_end - token);
+	buffer[token_end - token] = '\0';
+	char * parsed_end;
+	result = strtod(buffer, &parsed_end);
+	position = token_end;
+	return parsed_end == buffer + (token_end - token);
+}
+
+// Writes the decimal digits of <value> into <buffer> [at least 20 bytes], returns the number of characters
+inline int format_uint(uint64_t value, char * buffer) {
+	char digits[20];
+	int length = 0;
+	do {
+		digits[length++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	for (int i = 0; i < length; i++) {
+		buffer[i] = digits[length - 1 - i];
+	}
+	return length;
+}
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "csr_graph.hpp"
+#include "../Common/mapped_file.hpp"
+#include "../Common/binary_file.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstring>
+
+using namespace std;
+namespace graph
+{
+using common::aligned;
+using common::write_padded;
+
+// Class CSRGraph | Binary graph file
+
+void CSRGraph::map_binary(const shared_ptr<common::MappedFile> & file) {
+	// 1 - Validate the header
+	if (file->size() < sizeof(GraphBinaryHeader)) {
+		throw GraphFileException("Binary graph file is truncated");
+	}
+	GraphBinaryHeader header;
+	memcpy(&header, file->data(), sizeof(header));
+	if (header.version != GRAPH_VERSION) {
+		throw GraphFileException("Unsupported binary graph version");
+	}
+
+	const uint64_t n = header.num_vertices;
+	const uint64_t widths_offset = aligned(sizeof(GraphBinaryHeader));
+	const uint64_t offsets_offset = widths_offset + aligned(header.dimension * sizeof(uint));
+	const uint64_t degrees_offset = offsets_offset + (n + 1) * sizeof(uint64_t);
+	const uint64_t adjacency_offset = degrees_offset + n * sizeof(uint64_t);
+	const uint64_t weights_offset = adjacency_offset + aligned(header.num_entries * sizeof(uint));
+	const uint64_t expected_size = weights_offset + header.num_entries * sizeof(uint);
+	if (file->size() < expected_size) {
+		throw GraphFileException("Binary graph file is truncated");
+	}
+
+	// 2 - Point into the mapping, only the mode widths are copied. The rows are checked to fit the adjacency,
+	// the vertex ids in it are trusted like the coordinates of a binary tensor
+	const uint * mapped_widths = reinterpret_cast<const uint *>(file->data() + widths_offset);
+	widths.assign(mapped_widths, mapped_widths + header.dimension);
+	uint64_t total_width = 0;
+	for (uint mode = 0; mode < widths.size(); mode++) {
+		total_width += widths[mode];
+	}
+	if (!widths.empty() && total_width != n) {
+		throw GraphFileException("Dimension widths don't add up to the number of vertices");
+	}
+	mapped_offsets = reinterpret_cast<const uint64_t *>(file->data() + offsets_offset);
+	if (mapped_offsets[0] != 0 || mapped_offsets[n] != header.num_entries) {
+		throw GraphFileException("Binary graph file has inconsistent row offsets");
+	}
+	mapped_weighted_degrees = reinterpret_cast<const uint64_t *>(file->data() + degrees_offset);
+	mapped_adjacency = reinterpret_cast<const uint *>(file->data() + adjacency_offset);
+	mapped_weights = reinterpret_cast<const uint *>(file->data() + weights_offset);
+	vertex_count = header.num_vertices;
+	edge_count = header.num_edges;
+	mapping = file;
+
+	// the arrays built for text input are not used any more
+	vector<uint64_t>().swap(offsets);
+}
+
+void CSRGraph::write_binary(const string & filename) const {
+	ofstream os(filename, ios::binary);
+	if (!os.is_open()) {
+		throw GraphFileException("Cannot create the output graph file");
+	}
+
+	GraphBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GRAPH_MAGIC, sizeof(GRAPH_MAGIC));
+	header.version = GRAPH_VERSION;
+	header.dimension = widths.size();
+	header.num_vertices = vertex_count;
+	header.num_edges = edge_count;
+	header.num_entries = num_entries();
+
+	const uint64_t n = vertex_count;
+	write_padded(os, &header, sizeof(header));
+	write_padded(os, widths.data(), widths.size() * sizeof(uint));
+	os.write(reinterpret_cast<const char *>(row_offsets()), (n + 1) * sizeof(uint64_t));
+	os.write(reinterpret_cast<const char *>(mapping ? mapped_weighted_degrees : weighted_degrees.data()), n * sizeof(uint64_t));
+	write_padded(os, mapping ? mapped_adjacency : adjacency.data(), header.num_entries * sizeof(uint));
+	os.write(reinterpret_cast<const char *>(mapping ? mapped_weights : edge_weights.data()), header.num_entries * sizeof(uint));
+	if (!os) {
+		throw GraphFileException("Cannot write the output graph file");
+	}
+}
+}
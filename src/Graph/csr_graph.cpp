@@ -0,0 +1,165 @@
+#include "csr_graph.hpp"
+#include "../Common/mapped_file.hpp"
+#include "../Common/text_parse.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+namespace graph
+{
+
+// Class CSRGraph
+
+CSRGraph::CSRGraph()
+	: vertex_count(0), edge_count(0), offsets(1, 0), mapped_offsets(nullptr), mapped_weighted_degrees(nullptr),
+	mapped_adjacency(nullptr), mapped_weights(nullptr) { }
+
+CSRGraph::CSRGraph(const string & filename, bool symmetric)
+	: vertex_count(0), edge_count(0), offsets(1, 0), mapped_offsets(nullptr), mapped_weighted_degrees(nullptr),
+	mapped_adjacency(nullptr), mapped_weights(nullptr) {
+	shared_ptr<common::MappedFile> file;
+	try {
+		file = make_shared<common::MappedFile>(filename);
+	}
+	catch (const common::MappedFileException & exc) {
+		throw GraphFileException(exc.what());
+	}
+
+	if (file->size() >= sizeof(GRAPH_MAGIC) && memcmp(file->data(), GRAPH_MAGIC, sizeof(GRAPH_MAGIC)) == 0) {
+		map_binary(file);
+	}
+	else {
+		parse_text(file->data(), file->data() + file->size(), symmetric);
+	}
+}
+
+CSRGraph::CSRGraph(uint num_vertices, const vector<uint> & sources, const vector<uint> & targets,
+	const vector<uint> & weights, bool symmetric)
+	: vertex_count(num_vertices), edge_count(sources.size()), mapped_offsets(nullptr), mapped_weighted_degrees(nullptr),
+	mapped_adjacency(nullptr), mapped_weights(nullptr) {
+	build(sources, targets, weights, symmetric);
+}
+
+CSRGraph::CSRGraph(const vector<uint> & mode_widths, vector<uint64_t> row_offsets, vector<uint> row_adjacency,
+	vector<uint> row_weights, uint64_t num_edges)
+	: vertex_count(0), edge_count(num_edges), offsets(std::move(row_offsets)), adjacency(std::move(row_adjacency)),
+	edge_weights(std::move(row_weights)), mapped_offsets(nullptr), mapped_weighted_degrees(nullptr),
+	mapped_adjacency(nullptr), mapped_weights(nullptr) {
+	if (offsets.empty() || offsets.size() - 1 > UINT32_MAX) {
+		throw GraphFileException("Graph has too many vertices");
+	}
+	if (offsets.back() != adjacency.size() || adjacency.size() != edge_weights.size()) {
+		throw GraphFileException("Row offsets don't match the adjacency arrays");
+	}
+	vertex_count = static_cast<uint>(offsets.size() - 1);
+	weighted_degrees.assign(vertex_count, 0);
+	for (uint v = 0; v < vertex_count; v++) {
+		for (uint64_t e = offsets[v]; e < offsets[v + 1]; e++) {
+			weighted_degrees[v] += edge_weights[e];
+		}
+	}
+	set_dimension_widths(mode_widths);
+}
+
+void CSRGraph::set_dimension_widths(const vector<uint> & mode_widths) {
+	uint64_t total = 0;
+	for (uint mode = 0; mode < mode_widths.size(); mode++) {
+		total += mode_widths[mode];
+	}
+	if (total != vertex_count) {
+		throw GraphFileException("Dimension widths don't add up to the number of vertices");
+	}
+	widths = mode_widths;
+}
+
+// Class CSRGraph | Private Member Function Definitions
+
+void CSRGraph::parse_text(const char * position, const char * end, bool symmetric) {
+	vector<uint> sources, targets, weights;
+
+	// 1 - read the header info [dimension widths & # of edges]
+	uint64_t number;
+	const char * line = common::skip_blanks(position, end);
+	if (line == end || *line != '%') {
+		throw GraphFileException("Graph file is incompatible - header info not found");
+	}
+	line++;
+	uint64_t total_width = 0;
+	while (common::parse_uint(line, end, number)) {
+		widths.push_back(static_cast<uint>(number));
+		total_width += number;
+	}
+	if (total_width > UINT32_MAX) {
+		throw GraphFileException("Graph has too many vertices");
+	}
+	vertex_count = static_cast<uint>(total_width);
+
+	position = common::next_line(position, end);
+	line = common::skip_blanks(position, end);
+	if (line == end || *line != '%' || !common::parse_uint(++line, end, edge_count)) {
+		throw GraphFileException("Graph file is incompatible - header info not found");
+	}
+	position = common::next_line(position, end);
+
+	// 2 - read the edges of the graph
+	sources.reserve(edge_count);
+	targets.reserve(edge_count);
+	weights.reserve(edge_count);
+	for (; position != end; position = common::next_line(position, end)) {
+		if (!common::is_record(position, end)) {
+			continue;
+		}
+		uint64_t vertex1, vertex2, weight;
+		line = position;
+		if (!common::parse_uint(line, end, vertex1) || !common::parse_uint(line, end, vertex2)
+			|| !common::parse_uint(line, end, weight)) {
+			throw GraphFileException("Error during input parse");
+		}
+		if (vertex1 >= vertex_count || vertex2 >= vertex_count) {
+			throw GraphFileException("Graph file contains an edge to an unknown vertex");
+		}
+		sources.push_back(static_cast<uint>(vertex1));
+		targets.push_back(static_cast<uint>(vertex2));
+		weights.push_back(static_cast<uint>(weight));
+	}
+
+	build(sources, targets, weights, symmetric);
+}
+
+void CSRGraph::build(const vector<uint> & sources, const vector<uint> & targets, const vector<uint> & weights, bool symmetric) {
+	// 1 - Count the degree of each vertex, offsets[v + 1] holds the degree of v
+	offsets.assign(static_cast<uint64_t>(vertex_count) + 1, 0);
+	for (uint64_t i = 0; i < sources.size(); i++) {
+		offsets[sources[i] + 1]++;
+		if (symmetric) {
+			offsets[targets[i] + 1]++;
+		}
+	}
+
+	// 2 - Prefix sum turns the degrees into row offsets
+	for (uint v = 0; v < vertex_count; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+
+	// 3 - Scatter the edges into their rows, summing up the weighted degrees on the way
+	adjacency.resize(offsets.back());
+	edge_weights.resize(offsets.back());
+	weighted_degrees.assign(vertex_count, 0);
+	vector<uint64_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (uint64_t i = 0; i < sources.size(); i++) {
+		uint64_t position = cursor[sources[i]]++;
+		adjacency[position] = targets[i];
+		edge_weights[position] = weights[i];
+		weighted_degrees[sources[i]] += weights[i];
+		if (symmetric) {
+			position = cursor[targets[i]]++;
+			adjacency[position] = sources[i];
+			edge_weights[position] = weights[i];
+			weighted_degrees[targets[i]] += weights[i];
+		}
+	}
+}
+}
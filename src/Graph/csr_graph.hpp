@@ -0,0 +1,118 @@
+#ifndef _CSR_GRAPH_HPP
+#define _CSR_GRAPH_HPP
+
+#include <vector>
+#include <string>
+#include <exception>
+#include <memory>
+#include <cstdint>
+
+namespace common
+{
+class MappedFile;
+}
+
+namespace graph
+{
+typedef unsigned int uint;
+
+// Binary graph file, the CSR arrays as they are kept in memory. Every section starts at an 8 byte aligned offset:
+//   GraphBinaryHeader
+//   uint32 mode widths [dimension]
+//   uint64 row offsets [num_vertices + 1]
+//   uint64 weighted degrees [num_vertices]
+//   uint32 adjacency [num_entries]
+//   uint32 edge weights [num_entries]
+const char GRAPH_MAGIC[8] = { 'P', 'U', 'R', 'E', 'G', 'R', 'P', 'H' };
+const uint GRAPH_VERSION = 1;
+
+struct GraphBinaryHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t dimension;
+	uint32_t num_vertices;
+	uint32_t reserved;
+	uint64_t num_edges;
+	uint64_t num_entries;
+};
+
+// Immutable weighted graph in compressed sparse row format:
+// the neighbors of vertex v are adjacency[offsets[v] .. offsets[v + 1])
+class CSRGraph {
+public:
+	CSRGraph();
+	// Reads a graph in the format written by convert:
+	// % width1 width2 ... widthN
+	// % #_of_edges
+	// vertex1 vertex2 weight
+	// with <symmetric> each (vertex1, vertex2) line is stored in both directions.
+	// A binary graph file is mapped into memory instead and used as it was written, <symmetric> doesn't apply
+	explicit CSRGraph(const std::string & filename, bool symmetric = true);
+	// Builds the adjacency of <num_vertices> vertices from an edge list in one counting pass
+	CSRGraph(uint num_vertices, const std::vector<uint> & sources, const std::vector<uint> & targets,
+		const std::vector<uint> & edge_weights, bool symmetric = true);
+	// Takes over CSR arrays built elsewhere [e.g. by convert], the rows of a symmetric graph list both
+	// directions of each of the <num_edges> edges. The weighted degrees are summed up here
+	CSRGraph(const std::vector<uint> & mode_widths, std::vector<uint64_t> row_offsets, std::vector<uint> row_adjacency,
+		std::vector<uint> row_weights, uint64_t num_edges);
+
+	uint num_vertices() const { return vertex_count; }
+	uint64_t num_edges() const { return edge_count; } // edges listed in the input, (u, v) & (v, u) count once if symmetric
+	uint64_t num_entries() const { return row_offsets()[vertex_count]; } // directed entries in the adjacency
+	const std::vector<uint> & dimension_widths() const { return widths; }
+	void set_dimension_widths(const std::vector<uint> & mode_widths);
+	bool is_mapped() const { return static_cast<bool>(mapping); }
+
+	uint degree(uint v) const { return static_cast<uint>(row_offsets()[v + 1] - row_offsets()[v]); }
+	uint64_t weighted_degree(uint v) const { // sum of the weights of the row
+		return (mapping ? mapped_weighted_degrees : weighted_degrees.data())[v];
+	}
+	const uint * neighbors(uint v) const {
+		return (mapping ? mapped_adjacency : adjacency.data()) + row_offsets()[v];
+	}
+	const uint * weights(uint v) const {
+		return (mapping ? mapped_weights : edge_weights.data()) + row_offsets()[v];
+	}
+
+	// Writes the binary graph file the file constructor maps
+	void write_binary(const std::string & filename) const;
+private:
+	uint vertex_count;
+	uint64_t edge_count;
+	std::vector<uint> widths; // mode widths of the tensor the graph was built from
+	std::vector<uint64_t> offsets;
+	std::vector<uint> adjacency;
+	std::vector<uint> edge_weights;
+	std::vector<uint64_t> weighted_degrees;
+
+	// binary graph files are used in place, the mapping is shared between copies of the graph
+	std::shared_ptr<common::MappedFile> mapping;
+	const uint64_t * mapped_offsets;
+	const uint64_t * mapped_weighted_degrees;
+	const uint * mapped_adjacency;
+	const uint * mapped_weights;
+
+	const uint64_t * row_offsets() const { return mapping ? mapped_offsets : offsets.data(); }
+	void parse_text(const char * data, const char * end, bool symmetric);
+	void map_binary(const std::shared_ptr<common::MappedFile> & file);
+	void build(const std::vector<uint> & sources, const std::vector<uint> & targets,
+		const std::vector<uint> & weights, bool symmetric);
+};
+
+// =====================
+// EXCEPTION CLASS BELOW
+// =====================
+
+class GraphFileException : public std::exception {
+public:
+	GraphFileException(const char * msg) : msg(msg) { }
+
+	const char * what() const noexcept {
+		return msg;
+	}
+private:
+	const char * msg;
+};
+}
+
+#endif
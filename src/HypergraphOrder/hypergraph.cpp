@@ -0,0 +1,742 @@
+#include "hypergraph.hpp"
+#include <iostream>
+#include <algorithm>
+#include <queue>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <utility>
+#include "../Common/parallel.hpp"
+#include "../RelabelTensor/relabel.hpp"
+using namespace std;
+
+namespace hypergraph
+{
+namespace
+{
+const uint NONE = UINT_MAX;
+const uint64_t NO_BUCKET = UINT64_MAX;
+const uint COARSEST_VERTICES = 128; // coarsening stops once a hypergraph is this small
+const uint MAX_COARSENING_LEVELS = 32;
+const uint INITIAL_TRIES = 4; // partitions grown on the coarsest hypergraph, the one with the smallest cut is kept
+const uint FM_PASSES = 2;
+const uint FM_MAX_BAD_MOVES = 128; // a pass stops after this many moves without finding a better cut
+
+uint64_t splitmix(uint64_t & state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Part weights of a bisection & the limits every move has to respect
+struct Balance {
+	uint64_t weight[2];
+	uint64_t target[2];
+	uint64_t max_weight[2];
+
+	uint64_t deviation() const { return weight[0] > target[0] ? weight[0] - target[0] : target[0] - weight[0]; }
+};
+
+void measure(const Hypergraph & graph, const vector<uint8_t> & part, Balance & balance) {
+	balance.weight[0] = balance.weight[1] = 0;
+	for (uint v = 0; v < graph.num_vertices(); v++) {
+		balance.weight[part[v]] += graph.vertex_weights[v];
+	}
+}
+
+uint64_t cut_weight(const Hypergraph & graph, const vector<uint8_t> & part) {
+	uint64_t cut = 0;
+	for (uint e = 0; e < graph.num_edges(); e++) {
+		const uint8_t side = part[graph.pins[graph.edge_begin[e]]];
+		for (uint64_t p = graph.edge_begin[e] + 1; p < graph.edge_begin[e + 1]; p++) {
+			if (part[graph.pins[p]] != side) {
+				cut += graph.edge_weights[e];
+				break;
+			}
+		}
+	}
+	return cut;
+}
+
+// Heavy connectivity matching: every unmatched vertex [in random order] is matched with the unmatched neighbor
+// it shares the most hyperedge weight with, a hyperedge counting less the more pins it has.
+// Returns false without building <coarse> when the matching would barely shrink the hypergraph
+bool coarsen(const Hypergraph & fine, uint64_t max_vertex_weight, uint64_t & seed, Hypergraph & coarse, vector<uint> & map) {
+	const uint num_vertices = fine.num_vertices();
+	vector<uint> order(num_vertices);
+	for (uint v = 0; v < num_vertices; v++) {
+		order[v] = v;
+	}
+	for (uint i = num_vertices; i > 1; i--) {
+		swap(order[i - 1], order[splitmix(seed) % i]);
+	}
+
+	map.assign(num_vertices, NONE);
+	vector<double> score(num_vertices, 0);
+	vector<uint> touched;
+	uint coarse_count = 0;
+	for (uint i = 0; i < num_vertices; i++) {
+		const uint u = order[i];
+		if (map[u] != NONE) {
+			continue;
+		}
+		for (uint64_t k = fine.vertex_begin[u]; k < fine.vertex_begin[u + 1]; k++) {
+			const uint e = fine.incident_edges[k];
+			const uint64_t begin = fine.edge_begin[e], end = fine.edge_begin[e + 1];
+			const double connectivity = static_cast<double>(fine.edge_weights[e]) / (end - begin - 1);
+			for (uint64_t p = begin; p < end; p++) {
+				const uint v = fine.pins[p];
+				if (v != u && map[v] == NONE
+					&& static_cast<uint64_t>(fine.vertex_weights[u]) + fine.vertex_weights[v] <= max_vertex_weight) {
+					if (score[v] == 0) {
+						touched.push_back(v);
+					}
+					score[v] += connectivity;
+				}
+			}
+		}
+		uint best = NONE;
+		for (uint j = 0; j < touched.size(); j++) {
+			const uint v = touched[j];
+			if (best == NONE || score[v] > score[best]
+				|| (score[v] == score[best] && fine.vertex_weights[v] < fine.vertex_weights[best])) {
+				best = v;
+			}
+		}
+		for (uint j = 0; j < touched.size(); j++) {
+			score[touched[j]] = 0;
+		}
+		touched.clear();
+		map[u] = coarse_count;
+		if (best != NONE) {
+			map[best] = coarse_count;
+		}
+		coarse_count++;
+	}
+	if (coarse_count > num_vertices / 10 * 9) {
+		return false;
+	}
+
+	// contracted hyperedges, the ones left with a single pin can't be cut any more
+	coarse.vertex_weights.assign(coarse_count, 0);
+	for (uint v = 0; v < num_vertices; v++) {
+		coarse.vertex_weights[map[v]] += fine.vertex_weights[v];
+	}
+	coarse.edge_begin.assign(1, 0);
+	coarse.pins.clear();
+	coarse.edge_weights.clear();
+	vector<uint> edge;
+	for (uint e = 0; e < fine.num_edges(); e++) {
+		edge.clear();
+		for (uint64_t p = fine.edge_begin[e]; p < fine.edge_begin[e + 1]; p++) {
+			edge.push_back(map[fine.pins[p]]);
+		}
+		sort(edge.begin(), edge.end());
+		edge.erase(unique(edge.begin(), edge.end()), edge.end());
+		if (edge.size() >= 2) {
+			coarse.pins.insert(coarse.pins.end(), edge.begin(), edge.end());
+			coarse.edge_weights.push_back(fine.edge_weights[e]);
+			coarse.edge_begin.push_back(coarse.pins.size());
+		}
+	}
+	coarse.merge_identical_edges();
+	coarse.build_incidence();
+	return true;
+}
+
+// Part 0 grows breadth first from <seed_vertex> until it holds <target> weight,
+// another unvisited vertex is picked whenever the frontier runs dry
+void grow(const Hypergraph & graph, uint seed_vertex, uint64_t target, vector<uint8_t> & part) {
+	const uint num_vertices = graph.num_vertices();
+	part.assign(num_vertices, 1);
+	vector<uint8_t> visited(num_vertices, 0);
+	queue<uint> frontier;
+	frontier.push(seed_vertex);
+	visited[seed_vertex] = 1;
+	uint64_t weight = 0;
+	uint next_unvisited = 0;
+	while (weight < target) {
+		if (frontier.empty()) {
+			while (next_unvisited < num_vertices && visited[next_unvisited]) {
+				next_unvisited++;
+			}
+			if (next_unvisited == num_vertices) {
+				break;
+			}
+			visited[next_unvisited] = 1;
+			frontier.push(next_unvisited);
+		}
+		const uint u = frontier.front();
+		frontier.pop();
+		part[u] = 0;
+		weight += graph.vertex_weights[u];
+		for (uint64_t k = graph.vertex_begin[u]; k < graph.vertex_begin[u + 1]; k++) {
+			const uint e = graph.incident_edges[k];
+			for (uint64_t p = graph.edge_begin[e]; p < graph.edge_begin[e + 1]; p++) {
+				if (!visited[graph.pins[p]]) {
+					visited[graph.pins[p]] = 1;
+					frontier.push(graph.pins[p]);
+				}
+			}
+		}
+	}
+}
+
+// Moves vertices out of an overweight part, the ones whose move costs the least cut weight first
+void rebalance(const Hypergraph & graph, vector<uint8_t> & part, Balance & balance) {
+	for (uint8_t side = 0; side < 2; side++) {
+		if (balance.weight[side] <= balance.max_weight[side]) {
+			continue;
+		}
+		vector<uint> side_pins(graph.num_edges(), 0);
+		for (uint e = 0; e < graph.num_edges(); e++) {
+			for (uint64_t p = graph.edge_begin[e]; p < graph.edge_begin[e + 1]; p++) {
+				side_pins[e] += part[graph.pins[p]] == side;
+			}
+		}
+		vector< pair<int64_t, uint> > candidates;
+		for (uint v = 0; v < graph.num_vertices(); v++) {
+			if (part[v] != side) {
+				continue;
+			}
+			int64_t gain = 0;
+			for (uint64_t k = graph.vertex_begin[v]; k < graph.vertex_begin[v + 1]; k++) {
+				const uint e = graph.incident_edges[k];
+				if (side_pins[e] == 1) {
+					gain += graph.edge_weights[e];
+				}
+				else if (side_pins[e] == graph.edge_begin[e + 1] - graph.edge_begin[e]) {
+					gain -= graph.edge_weights[e];
+				}
+			}
+			candidates.push_back(make_pair(-gain, v));
+		}
+		sort(candidates.begin(), candidates.end());
+		for (uint i = 0; i < candidates.size() && balance.weight[side] > balance.max_weight[side]; i++) {
+			const uint v = candidates[i].second;
+			if (balance.weight[1 - side] + graph.vertex_weights[v] <= balance.max_weight[1 - side]) {
+				part[v] = 1 - side;
+				balance.weight[side] -= graph.vertex_weights[v];
+				balance.weight[1 - side] += graph.vertex_weights[v];
+			}
+		}
+	}
+}
+
+// Vertices of one part bucketed by their gain [the Fiduccia-Mattheyses bucket list]: inserting, removing
+// and updating a vertex is O(1), the highest gain is found by walking down from the last highest bucket
+class GainBuckets {
+public:
+	void reset(uint num_vertices, int64_t max_gain) {
+		offset = max_gain;
+		heads.assign(2 * max_gain + 1, NONE);
+		next.resize(num_vertices);
+		previous.resize(num_vertices);
+		bucket.assign(num_vertices, NO_BUCKET);
+		highest = 0;
+		size = 0;
+	}
+
+	bool empty() const { return size == 0; }
+	bool contains(uint v) const { return bucket[v] != NO_BUCKET; }
+
+	void insert(uint v, int64_t gain) {
+		const uint64_t b = gain + offset;
+		previous[v] = NONE;
+		next[v] = heads[b];
+		if (heads[b] != NONE) {
+			previous[heads[b]] = v;
+		}
+		heads[b] = v;
+		bucket[v] = b;
+		if (size == 0 || b > highest) {
+			highest = b;
+		}
+		size++;
+	}
+
+	void remove(uint v) {
+		const uint64_t b = bucket[v];
+		if (previous[v] != NONE) {
+			next[previous[v]] = next[v];
+		}
+		else {
+			heads[b] = next[v];
+		}
+		if (next[v] != NONE) {
+			previous[next[v]] = previous[v];
+		}
+		bucket[v] = NO_BUCKET;
+		size--;
+	}
+
+	void update(uint v, int64_t gain) {
+		if (contains(v)) {
+			remove(v);
+		}
+		insert(v, gain);
+	}
+
+	uint top() { // a vertex with the highest gain, the buckets must not be empty
+		while (heads[highest] == NONE) {
+			highest--;
+		}
+		return heads[highest];
+	}
+private:
+	int64_t offset; // bucket of gain g is g + offset
+	std::vector<uint> heads;
+	std::vector<uint> next;
+	std::vector<uint> previous;
+	std::vector<uint64_t> bucket;
+	uint64_t highest;
+	uint size;
+};
+
+// Fiduccia-Mattheyses passes: vertices move to the other part by decreasing gain [each at most once per pass]
+// while the parts stay within their limits, then the pass is rolled back to its smallest cut
+void refine(const Hypergraph & graph, vector<uint8_t> & part, Balance & balance) {
+	const uint num_vertices = graph.num_vertices(), num_edges = graph.num_edges();
+	int64_t max_gain = 0; // no gain exceeds the weighted degree of its vertex
+	for (uint v = 0; v < num_vertices; v++) {
+		int64_t degree = 0;
+		for (uint64_t k = graph.vertex_begin[v]; k < graph.vertex_begin[v + 1]; k++) {
+			degree += graph.edge_weights[graph.incident_edges[k]];
+		}
+		max_gain = max(max_gain, degree);
+	}
+	vector<uint> pin_counts[2] = { vector<uint>(num_edges), vector<uint>(num_edges) };
+	vector<int64_t> gain(num_vertices);
+	vector<uint8_t> locked(num_vertices);
+	vector<uint> moves;
+	// one bucket list per part, so a part that can't give away weight doesn't hold up the other one
+	GainBuckets buckets[2];
+	for (uint pass = 0; pass < FM_PASSES; pass++) {
+		fill(pin_counts[0].begin(), pin_counts[0].end(), 0);
+		fill(pin_counts[1].begin(), pin_counts[1].end(), 0);
+		for (uint e = 0; e < num_edges; e++) {
+			for (uint64_t p = graph.edge_begin[e]; p < graph.edge_begin[e + 1]; p++) {
+				pin_counts[part[graph.pins[p]]][e]++;
+			}
+		}
+		// only vertices on cut hyperedges start in the buckets, the others join once a move changes their gain
+		buckets[0].reset(num_vertices, max_gain);
+		buckets[1].reset(num_vertices, max_gain);
+		for (uint v = 0; v < num_vertices; v++) {
+			const uint8_t from = part[v], to = 1 - from;
+			bool boundary = false;
+			gain[v] = 0;
+			for (uint64_t k = graph.vertex_begin[v]; k < graph.vertex_begin[v + 1]; k++) {
+				const uint e = graph.incident_edges[k];
+				if (pin_counts[from][e] == 1) {
+					gain[v] += graph.edge_weights[e];
+				}
+				if (pin_counts[to][e] == 0) {
+					gain[v] -= graph.edge_weights[e];
+				}
+				else {
+					boundary = true;
+				}
+			}
+			if (boundary) {
+				buckets[from].insert(v, gain[v]);
+			}
+		}
+
+		fill(locked.begin(), locked.end(), 0);
+		moves.clear();
+		int64_t cut_change = 0, best_change = 0;
+		uint64_t best_deviation = balance.deviation();
+		size_t best_moves = 0;
+		uint bad_moves = 0;
+		while (bad_moves < FM_MAX_BAD_MOVES && !(buckets[0].empty() && buckets[1].empty())) {
+			bool feasible[2];
+			for (uint side = 0; side < 2; side++) {
+				feasible[side] = !buckets[side].empty()
+					&& balance.weight[1 - side] + graph.vertex_weights[buckets[side].top()] <= balance.max_weight[1 - side];
+			}
+			uint8_t from;
+			if (feasible[0] != feasible[1]) {
+				from = feasible[0] ? 0 : 1;
+			}
+			else {
+				from = buckets[1].empty() || (!buckets[0].empty() && gain[buckets[0].top()] >= gain[buckets[1].top()]) ? 0 : 1;
+			}
+			const uint v = buckets[from].top();
+			buckets[from].remove(v);
+			if (!feasible[from]) {
+				continue; // too heavy for the other part, it comes back once its gain changes
+			}
+			const uint8_t to = 1 - from;
+			const int64_t move_gain = gain[v];
+			locked[v] = 1;
+			for (uint64_t k = graph.vertex_begin[v]; k < graph.vertex_begin[v + 1]; k++) {
+				const uint e = graph.incident_edges[k];
+				const int64_t weight = graph.edge_weights[e];
+				const uint64_t begin = graph.edge_begin[e], end = graph.edge_begin[e + 1];
+				if (pin_counts[to][e] == 0) { // the hyperedge gets cut, moving any other pin no longer cuts it
+					for (uint64_t p = begin; p < end; p++) {
+						const uint u = graph.pins[p];
+						if (!locked[u]) {
+							gain[u] += weight;
+							buckets[part[u]].update(u, gain[u]);
+						}
+					}
+				}
+				else if (pin_counts[to][e] == 1) { // the single pin on the other side can't uncut it any more
+					for (uint64_t p = begin; p < end; p++) {
+						const uint u = graph.pins[p];
+						if (part[u] == to && !locked[u]) {
+							gain[u] -= weight;
+							buckets[to].update(u, gain[u]);
+						}
+					}
+				}
+				pin_counts[from][e]--;
+				pin_counts[to][e]++;
+				if (pin_counts[from][e] == 0) { // the hyperedge is uncut, moving any pin cuts it again
+					for (uint64_t p = begin; p < end; p++) {
+						const uint u = graph.pins[p];
+						if (!locked[u]) {
+							gain[u] -= weight;
+							buckets[part[u]].update(u, gain[u]);
+						}
+					}
+				}
+				else if (pin_counts[from][e] == 1) { // moving the last pin left behind uncuts it
+					for (uint64_t p = begin; p < end; p++) {
+						const uint u = graph.pins[p];
+						if (part[u] == from && !locked[u]) {
+							gain[u] += weight;
+							buckets[from].update(u, gain[u]);
+						}
+					}
+				}
+			}
+			part[v] = to;
+			balance.weight[from] -= graph.vertex_weights[v];
+			balance.weight[to] += graph.vertex_weights[v];
+			cut_change -= move_gain;
+			moves.push_back(v);
+			if (cut_change < best_change || (cut_change == best_change && balance.deviation() < best_deviation)) {
+				best_change = cut_change;
+				best_deviation = balance.deviation();
+				best_moves = moves.size();
+				bad_moves = 0;
+			}
+			else {
+				bad_moves++;
+			}
+		}
+
+		for (size_t i = moves.size(); i-- > best_moves;) {
+			const uint v = moves[i];
+			const uint8_t from = part[v];
+			part[v] = 1 - from;
+			balance.weight[from] -= graph.vertex_weights[v];
+			balance.weight[1 - from] += graph.vertex_weights[v];
+		}
+		if (best_change == 0) {
+			break;
+		}
+	}
+}
+}
+
+// Struct Hypergraph
+
+uint64_t Hypergraph::total_vertex_weight() const {
+	uint64_t total = 0;
+	for (uint v = 0; v < num_vertices(); v++) {
+		total += vertex_weights[v];
+	}
+	return total;
+}
+
+void Hypergraph::build_incidence() {
+	const uint num_vertices = this->num_vertices();
+	vertex_begin.assign(num_vertices + 1, 0);
+	for (uint64_t p = 0; p < pins.size(); p++) {
+		vertex_begin[pins[p] + 1]++;
+	}
+	for (uint v = 0; v < num_vertices; v++) {
+		vertex_begin[v + 1] += vertex_begin[v];
+	}
+	incident_edges.resize(pins.size());
+	vector<uint64_t> position(vertex_begin.begin(), vertex_begin.end() - 1);
+	for (uint e = 0; e < num_edges(); e++) {
+		for (uint64_t p = edge_begin[e]; p < edge_begin[e + 1]; p++) {
+			incident_edges[position[pins[p]]++] = e;
+		}
+	}
+}
+
+void Hypergraph::merge_identical_edges() {
+	// hyperedges with the same pins end up next to each other once they are sorted by a hash of their pins
+	const uint num_edges = this->num_edges();
+	vector< pair<uint64_t, uint> > hashes(num_edges);
+	for (uint e = 0; e < num_edges; e++) {
+		uint64_t hash = edge_begin[e + 1] - edge_begin[e];
+		for (uint64_t p = edge_begin[e]; p < edge_begin[e + 1]; p++) {
+			hash = (hash ^ pins[p]) * 0x100000001B3ULL;
+		}
+		hashes[e] = make_pair(splitmix(hash), e);
+	}
+	sort(hashes.begin(), hashes.end());
+
+	vector<uint64_t> merged_begin(1, 0);
+	vector<uint> merged_pins, merged_weights;
+	merged_pins.reserve(pins.size());
+	for (uint i = 0, group_end; i < num_edges; i = group_end) {
+		group_end = i;
+		while (group_end < num_edges && hashes[group_end].first == hashes[i].first) {
+			group_end++;
+		}
+		const uint group_begin = merged_weights.size();
+		for (uint j = i; j < group_end; j++) {
+			const uint e = hashes[j].second;
+			const uint64_t size = edge_begin[e + 1] - edge_begin[e];
+			uint match = NONE;
+			for (uint candidate = group_begin; candidate < merged_weights.size() && match == NONE; candidate++) {
+				if (merged_begin[candidate + 1] - merged_begin[candidate] == size
+					&& equal(pins.begin() + edge_begin[e], pins.begin() + edge_begin[e + 1], merged_pins.begin() + merged_begin[candidate])) {
+					match = candidate;
+				}
+			}
+			if (match != NONE) {
+				merged_weights[match] += edge_weights[e];
+			}
+			else {
+				merged_pins.insert(merged_pins.end(), pins.begin() + edge_begin[e], pins.begin() + edge_begin[e + 1]);
+				merged_weights.push_back(edge_weights[e]);
+				merged_begin.push_back(merged_pins.size());
+			}
+		}
+	}
+	edge_begin.swap(merged_begin);
+	pins.swap(merged_pins);
+	edge_weights.swap(merged_weights);
+}
+
+// Class HypergraphOrder
+
+HypergraphOrder::HypergraphOrder(const tensor::CooTensor & coo, uint num_threads, uint leaf_size, double imbalance, bool verbose)
+	: widths(coo.mode_widths()), num_threads(num_threads == 0 ? common::default_thread_count() : num_threads),
+	leaf_size(max(leaf_size, 1u)), imbalance(imbalance), verbose(verbose) {
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	const uint dimension = coo.dimension();
+	vector<uint64_t> offsets(dimension + 1, 0);
+	for (uint mode = 0; mode < dimension; mode++) {
+		offsets[mode + 1] = offsets[mode] + widths[mode];
+	}
+	if (offsets[dimension] >= UINT_MAX) {
+		throw HypergraphException("The tensor has more vertices than 32 bit labels can hold");
+	}
+	if (coo.nnz() >= UINT_MAX) {
+		throw HypergraphException("The tensor has more nonzeros than 32 bit hyperedge ids can hold");
+	}
+
+	// one hyperedge per nonzero, its pins are sorted since the mode offsets increase
+	const uint64_t num_edges = dimension < 2 ? 0 : coo.nnz(); // a single mode has no vertices to bring together
+	root.vertex_weights.assign(offsets[dimension], 1);
+	root.edge_weights.assign(num_edges, 1);
+	root.edge_begin.resize(num_edges + 1);
+	root.pins.resize(num_edges * dimension);
+	common::parallel_blocks(num_edges, this->num_threads, [&](uint64_t first, uint64_t last, uint) {
+		for (uint mode = 0; mode < dimension; mode++) {
+			const uint * coordinates = coo.coordinates(mode);
+			for (uint64_t e = first; e < last; e++) {
+				root.pins[e * dimension + mode] = offsets[mode] + coordinates[e];
+			}
+		}
+		for (uint64_t e = first; e < last; e++) {
+			root.edge_begin[e] = e * dimension;
+		}
+	});
+	root.edge_begin[num_edges] = num_edges * dimension;
+	root.build_incidence();
+	end = chrono::high_resolution_clock::now();
+	cout << "Hypergraph: " << root.num_vertices() << " vertices, " << root.num_edges() << " hyperedges ["
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+}
+
+const vector<uint> & HypergraphOrder::computePermutation() {
+	if (!new_labels.empty() || root.num_vertices() == 0) {
+		return new_labels;
+	}
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	new_labels.assign(root.num_vertices(), NONE);
+
+	// every level of the recursion is a batch of independent subproblems, the root hypergraph is handed to the first one
+	vector<Subproblem> level(1);
+	level[0].graph = std::move(root);
+	level[0].vertices.resize(level[0].graph.num_vertices());
+	for (uint v = 0; v < level[0].vertices.size(); v++) {
+		level[0].vertices[v] = v;
+	}
+	level[0].first_label = 0;
+	uint depth = 0;
+	while (!level.empty()) {
+		vector<Subproblem> children(2 * level.size());
+		vector<uint8_t> split(level.size(), 0);
+		atomic<uint> next_problem(0);
+		common::run_threads(min<uint>(num_threads, level.size()), [&](uint) {
+			for (uint i = next_problem++; i < level.size(); i = next_problem++) {
+				split[i] = process(level[i], children[2 * i], children[2 * i + 1]);
+				level[i] = Subproblem(); // the hypergraph of a subproblem isn't needed once it is split
+			}
+		});
+
+		vector<Subproblem> next_level;
+		for (uint i = 0; i < split.size(); i++) {
+			if (split[i]) {
+				next_level.push_back(std::move(children[2 * i]));
+				next_level.push_back(std::move(children[2 * i + 1]));
+			}
+		}
+		level.swap(next_level);
+		depth++;
+		if (verbose) {
+			cout << "Recursion level " << depth << ": " << level.size() << " subproblems left" << endl;
+		}
+	}
+	end = chrono::high_resolution_clock::now();
+	cout << "End: recursive bisection, " << depth << " levels ["
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+	return new_labels;
+}
+
+void HypergraphOrder::write_permutation(const string & output_file) const {
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	if (!relabel::write_permutation_file(output_file, widths, new_labels)) {
+		throw HypergraphException("Cannot write the permutation file");
+	}
+	end = chrono::high_resolution_clock::now();
+	cout << "Permutation has been written to " << output_file << " ["
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+}
+
+// Class HypergraphOrder | Private Member Function Definitions
+
+void HypergraphOrder::bisect(const Hypergraph & graph, uint64_t seed, vector<uint8_t> & part) const {
+	Balance balance;
+	const uint64_t total_weight = graph.total_vertex_weight();
+	balance.target[0] = total_weight / 2;
+	balance.target[1] = total_weight - balance.target[0];
+	for (uint side = 0; side < 2; side++) {
+		balance.max_weight[side] = max(balance.target[side], static_cast<uint64_t>(balance.target[side] * (1 + imbalance)));
+	}
+
+	// 1 - coarsening, levels[l] is matched down from levels[l - 1] [the hypergraph itself for l = 0] through maps[l]
+	const uint64_t max_vertex_weight = max<uint64_t>(1, total_weight / (COARSEST_VERTICES / 2));
+	vector<Hypergraph> levels;
+	vector< vector<uint> > maps;
+	levels.reserve(MAX_COARSENING_LEVELS);
+	maps.reserve(MAX_COARSENING_LEVELS);
+	while (maps.size() < MAX_COARSENING_LEVELS) {
+		const Hypergraph & current = levels.empty() ? graph : levels.back();
+		if (current.num_vertices() <= COARSEST_VERTICES) {
+			break;
+		}
+		Hypergraph coarse;
+		vector<uint> map;
+		if (!coarsen(current, max_vertex_weight, seed, coarse, map)) {
+			break;
+		}
+		levels.push_back(std::move(coarse));
+		maps.push_back(std::move(map));
+	}
+
+	// 2 - initial bisection of the coarsest hypergraph
+	const Hypergraph & coarsest = levels.empty() ? graph : levels.back();
+	vector<uint8_t> trial;
+	uint64_t best_cut = UINT64_MAX, best_deviation = UINT64_MAX;
+	for (uint attempt = 0; attempt < INITIAL_TRIES; attempt++) {
+		grow(coarsest, splitmix(seed) % coarsest.num_vertices(), balance.target[0], trial);
+		Balance trial_balance = balance;
+		measure(coarsest, trial, trial_balance);
+		rebalance(coarsest, trial, trial_balance);
+		refine(coarsest, trial, trial_balance);
+		const uint64_t cut = cut_weight(coarsest, trial);
+		if (cut < best_cut || (cut == best_cut && trial_balance.deviation() < best_deviation)) {
+			best_cut = cut;
+			best_deviation = trial_balance.deviation();
+			part = trial;
+		}
+	}
+
+	// 3 - the bisection is projected back level by level & refined on each
+	for (uint level = maps.size(); level-- > 0;) {
+		const Hypergraph & fine = level == 0 ? graph : levels[level - 1];
+		const vector<uint> & map = maps[level];
+		trial.resize(fine.num_vertices());
+		for (uint v = 0; v < fine.num_vertices(); v++) {
+			trial[v] = part[map[v]];
+		}
+		part.swap(trial);
+		levels.pop_back();
+		measure(fine, part, balance);
+		rebalance(fine, part, balance);
+		refine(fine, part, balance);
+	}
+}
+
+bool HypergraphOrder::process(Subproblem & problem, Subproblem & first, Subproblem & second) {
+	const uint num_vertices = problem.vertices.size();
+	if (num_vertices <= leaf_size || problem.graph.num_edges() == 0) {
+		for (uint v = 0; v < num_vertices; v++) {
+			new_labels[problem.vertices[v]] = problem.first_label + v;
+		}
+		return false;
+	}
+
+	// the seed only depends on the position of the subproblem, not on the thread bisecting it
+	uint64_t seed = (static_cast<uint64_t>(problem.first_label) << 32) | num_vertices;
+	vector<uint8_t> part;
+	bisect(problem.graph, seed, part);
+	const uint first_size = count(part.begin(), part.end(), 0);
+	if (first_size == 0 || first_size == num_vertices) {
+		for (uint v = 0; v < num_vertices; v++) {
+			part[v] = v >= num_vertices / 2;
+		}
+	}
+	extract(problem, part, 0, first);
+	extract(problem, part, 1, second);
+	first.first_label = problem.first_label;
+	second.first_label = problem.first_label + first.vertices.size();
+	return true;
+}
+
+void HypergraphOrder::extract(const Subproblem & problem, const vector<uint8_t> & part, uint8_t side, Subproblem & child) {
+	const Hypergraph & graph = problem.graph;
+	Hypergraph & sub = child.graph;
+	vector<uint> local(graph.num_vertices(), NONE);
+	for (uint v = 0; v < graph.num_vertices(); v++) {
+		if (part[v] == side) {
+			local[v] = child.vertices.size();
+			child.vertices.push_back(problem.vertices[v]);
+			sub.vertex_weights.push_back(graph.vertex_weights[v]);
+		}
+	}
+	// hyperedges keep their pins on this side, the ones left with a single pin are dropped
+	sub.edge_begin.assign(1, 0);
+	for (uint e = 0; e < graph.num_edges(); e++) {
+		const uint64_t start = sub.pins.size();
+		for (uint64_t p = graph.edge_begin[e]; p < graph.edge_begin[e + 1]; p++) {
+			if (part[graph.pins[p]] == side) {
+				sub.pins.push_back(local[graph.pins[p]]);
+			}
+		}
+		if (sub.pins.size() - start >= 2) {
+			sub.edge_weights.push_back(graph.edge_weights[e]);
+			sub.edge_begin.push_back(sub.pins.size());
+		}
+		else {
+			sub.pins.resize(start);
+		}
+	}
+	sub.merge_identical_edges();
+	sub.build_incidence();
+}
+}
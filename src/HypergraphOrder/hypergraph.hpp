@@ -0,0 +1,84 @@
+#ifndef _HYPERGRAPH_HPP
+#define _HYPERGRAPH_HPP
+
+#include <vector>
+#include <string>
+#include <exception>
+#include <cstdint>
+#include "../Tensor/tensor.hpp"
+
+namespace hypergraph
+{
+typedef unsigned int uint;
+
+// Hypergraph kept in both CSR directions: the pins of every hyperedge and the hyperedges of every vertex
+struct Hypergraph {
+	std::vector<uint64_t> edge_begin; // [num_edges + 1]
+	std::vector<uint> pins; // sorted within a hyperedge
+	std::vector<uint> edge_weights;
+	std::vector<uint64_t> vertex_begin; // [num_vertices + 1]
+	std::vector<uint> incident_edges;
+	std::vector<uint> vertex_weights;
+
+	uint num_vertices() const { return vertex_weights.size(); }
+	uint num_edges() const { return edge_weights.size(); }
+	uint64_t total_vertex_weight() const;
+	void build_incidence(); // vertex_begin & incident_edges from the pins
+	void merge_identical_edges(); // hyperedges with the same pins become one, their weights are added up
+};
+
+// Orders the vertices of the k-partite graph of a tensor [vertex ids include the mode offsets, as convert
+// numbers them] without building that graph: every nonzero is a hyperedge over its d coordinates.
+// The hypergraph is bisected recursively, every bisection coarsens it by heavy connectivity matching,
+// partitions the coarsest hypergraph and refines the cut with Fiduccia-Mattheyses passes while projecting
+// it back. Vertices of the first part get the lower labels, the subproblems of one recursion level are
+// bisected in parallel. The permutation doesn't depend on the number of threads
+class HypergraphOrder {
+public:
+	// <leaf_size> is the largest subproblem that isn't bisected any more, <imbalance> the allowed
+	// deviation of a part from half of the vertices
+	explicit HypergraphOrder(const tensor::CooTensor & coo, uint num_threads = 0, uint leaf_size = 32,
+		double imbalance = 0.05, bool verbose = false);
+
+	const std::vector<uint> & computePermutation(); // new label of every vertex
+	void write_permutation(const std::string & output_file) const; // the format relabel reads
+	const std::vector<uint> & dimension_widths() const { return widths; }
+private:
+	struct Subproblem {
+		Hypergraph graph;
+		std::vector<uint> vertices; // tensor graph vertex of every local vertex
+		uint first_label; // the vertices of the subproblem get [first_label, first_label + vertices.size())
+	};
+
+	std::vector<uint> widths;
+	Hypergraph root;
+	std::vector<uint> new_labels;
+	uint num_threads;
+	uint leaf_size;
+	double imbalance;
+	bool verbose;
+
+	// Splits the vertices into part 0 & part 1 with the smallest cut it finds, <seed> drives every random choice
+	void bisect(const Hypergraph & graph, uint64_t seed, std::vector<uint8_t> & part) const;
+	// Either labels the vertices of a leaf or bisects the subproblem into <children> [returns false for leaves]
+	bool process(Subproblem & problem, Subproblem & first, Subproblem & second);
+	static void extract(const Subproblem & problem, const std::vector<uint8_t> & part, uint8_t side, Subproblem & child);
+};
+
+// =====================
+// EXCEPTION CLASS BELOW
+// =====================
+
+class HypergraphException : public std::exception {
+public:
+	HypergraphException(const char * msg) : msg(msg) { }
+
+	const char * what() const noexcept {
+		return msg;
+	}
+private:
+	const char * msg;
+};
+}
+
+#endif
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "hypergraph.hpp"
+#include "../Tensor/tensor.hpp"
+using namespace std;
+
+namespace hypergraph
+{
+void usage() {
+	cout << "Usage: PURE hypergraph TENSOR -[OPTIONS...]" << endl;
+}
+
+void help() {
+	cout << "Hypergraph ordering" << endl
+		<< "-------------------" << endl
+		<< "Orders the tensor by recursive bisection of its hypergraph [one hyperedge per nonzero]," << endl
+		<< "the permutation has the format relabel reads, no k-partite graph is built" << endl;
+	usage();
+	cout << "Available options" << endl
+		<< "\t-o FILENAME\t\t name of the permutation file [default: hypergraph_permutation.txt]" << endl
+		<< "\t-leaf_size N\t\t subproblems up to N vertices keep their order [default: 32]" << endl
+		<< "\t-imbalance X\t\t allowed deviation of a part from half of the vertices [default: 0.05]" << endl
+		<< "\t-threads N\t\t number of threads bisecting subproblems" << endl
+		<< "\t-no_values \t\t tensor file does NOT contain values" << endl
+		<< "\t-v \t\t verbose mode" << endl;
+}
+
+int hypergraphMain(int argc, char * argv[]) {
+	cout << "************************************" << endl;
+	// 1 - parse the command line options
+	vector<string> arguments(argc);
+	for (int i = 0; i < argc; i++) {
+		arguments[i] = string(argv[i]);
+	}
+
+	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
+		help();
+		exit(0);
+	}
+	else if (argc < 2) {
+		usage();
+		exit(0);
+	}
+
+	bool values_exist = true, verbose = false;
+	uint num_threads = 0, leaf_size = 32;
+	double imbalance = 0.05;
+	string tensor_file, output_file = "hypergraph_permutation.txt";
+	for (int i = 1; i < argc; i++) {
+		if (arguments[i] == "-no_values") {
+			values_exist = false;
+		}
+		else if (arguments[i] == "-v") {
+			verbose = true;
+		}
+		else if (arguments[i] == "-o" || arguments[i] == "-leaf_size" || arguments[i] == "-imbalance" || arguments[i] == "-threads") {
+			if (i + 1 >= argc || arguments[i + 1][0] == '-') {
+				cerr << "expected a value after " << arguments[i] << ", didn't find one!" << endl;
+				exit(1);
+			}
+			const string & value = arguments[++i];
+			if (arguments[i - 1] == "-o") {
+				output_file = value;
+			}
+			else if (arguments[i - 1] == "-leaf_size") {
+				leaf_size = atoi(value.c_str());
+			}
+			else if (arguments[i - 1] == "-imbalance") {
+				imbalance = atof(value.c_str());
+			}
+			else {
+				num_threads = atoi(value.c_str());
+			}
+		}
+		else if (arguments[i][0] != '-' && tensor_file == "") {
+			tensor_file = arguments[i];
+		}
+		else { // unknown argument!
+			cerr << "Unknown argument encountered: " << arguments[i] << endl;
+			exit(1);
+		}
+	}
+
+	if (tensor_file == "") {
+		cerr << "A tensor file must be provided!" << endl;
+		exit(1);
+	}
+	if (imbalance < 0) {
+		cerr << "The imbalance can't be negative" << endl;
+		exit(1);
+	}
+
+	// 2 - permutation
+	try {
+		tensor::CooTensor coo(tensor_file, values_exist, num_threads);
+		cout << "Read " << coo.nnz() << " nonzeros from the tensor file" << endl;
+		HypergraphOrder ordering(coo, num_threads, leaf_size, imbalance, verbose);
+		ordering.computePermutation();
+		ordering.write_permutation(output_file);
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot read the tensor file " << tensor_file << ": " << exc.what() << endl;
+		exit(1);
+	}
+	catch (HypergraphException & exc) {
+		cerr << "Cannot order the tensor: " << exc.what() << endl;
+		exit(1);
+	}
+	cout << "************************************" << endl;
+	return 0;
+}
+}
@@ -0,0 +1,195 @@
+#include "lexi_order.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include "../Common/radix_sort.hpp"
+#include "../Common/parallel.hpp"
+#include "../RelabelTensor/relabel.hpp"
+using namespace std;
+
+namespace lexi
+{
+
+// Class LexiOrder
+
+LexiOrder::LexiOrder(const tensor::CooTensor & coo, uint rounds, uint num_threads, bool verbose)
+	: coo(coo), rounds(rounds), num_threads(num_threads == 0 ? common::default_thread_count() : num_threads), verbose(verbose) {
+	// the natural labeling is the starting point
+	const vector<uint> & widths = coo.mode_widths();
+	labels.resize(widths.size());
+	for (uint mode = 0; mode < widths.size(); mode++) {
+		labels[mode].resize(widths[mode]);
+		for (uint c = 0; c < widths[mode]; c++) {
+			labels[mode][c] = c;
+		}
+	}
+}
+
+const vector<uint> & LexiOrder::computePermutation() {
+	if (!new_labels.empty()) {
+		return new_labels;
+	}
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	const uint dimension = coo.dimension();
+	uint round = 0;
+	while (round < rounds && dimension >= 2) {
+		chrono::high_resolution_clock::time_point round_begin = chrono::high_resolution_clock::now();
+		// a mode is sorted with the labels the modes before it got in this round [Gauss-Seidel order]
+		vector< vector<uint> > previous(labels);
+		for (uint mode = 0; mode < dimension; mode++) {
+			vector<uint> mode_labels;
+			if (coo.nnz() <= UINT_MAX) {
+				order_mode<uint32_t>(mode, num_threads, mode_labels);
+			}
+			else {
+				order_mode<uint64_t>(mode, num_threads, mode_labels);
+			}
+			labels[mode].swap(mode_labels);
+		}
+		uint64_t changed = 0;
+		for (uint mode = 0; mode < dimension; mode++) {
+			for (uint c = 0; c < labels[mode].size(); c++) {
+				changed += previous[mode][c] != labels[mode][c];
+			}
+		}
+		round++;
+		if (verbose) {
+			cout << "Round " << round << ": " << changed << " labels changed ["
+				<< chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - round_begin).count()
+				<< " ms]" << endl;
+		}
+		if (changed == 0) {
+			break;
+		}
+	}
+
+	// the labels of a mode follow the ones of the modes before it, relabel only compares labels within a mode
+	uint offset = 0;
+	for (uint mode = 0; mode < dimension; mode++) {
+		for (uint c = 0; c < labels[mode].size(); c++) {
+			new_labels.push_back(offset + labels[mode][c]);
+		}
+		offset += labels[mode].size();
+	}
+	end = chrono::high_resolution_clock::now();
+	cout << "End: Lexi-Order, " << round << " rounds ["
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+	return new_labels;
+}
+
+void LexiOrder::write_permutation(const string & output_file) const {
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	if (!relabel::write_permutation_file(output_file, coo.mode_widths(), new_labels)) {
+		throw LexiException("Cannot write the permutation file");
+	}
+	end = chrono::high_resolution_clock::now();
+	cout << "Permutation has been written to " << output_file << " ["
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+}
+
+// Class LexiOrder | Private Member Function Definitions
+
+template <typename Index>
+void LexiOrder::order_mode(uint mode, uint num_threads, vector<uint> & mode_labels) const {
+	const uint dimension = coo.dimension(), width = labels[mode].size();
+
+	// 1 - Nonzeros sorted by the other modes in their current labels, the first one being the most significant.
+	// LSD order like the CSF tree: as many modes as fit are packed into one key and sorted by one stable radix sort
+	const uint64_t nnz = coo.nnz();
+	vector<uint> others, bits;
+	for (uint m = 0; m < dimension; m++) {
+		if (m != mode) {
+			others.push_back(m);
+			bits.push_back(common::bits_for(labels[m].empty() ? 0 : labels[m].size() - 1));
+		}
+	}
+	vector<Index> sorted(nnz);
+	for (Index i = 0; i < nnz; i++) {
+		sorted[i] = i;
+	}
+	vector<uint64_t> keys(nnz);
+	uint passes = 0;
+	{
+		int last = static_cast<int>(others.size()) - 1;
+		while (last >= 0) {
+			uint key_bits = 0;
+			int first = last;
+			while (first >= 0 && key_bits + bits[first] <= 64) {
+				key_bits += bits[first];
+				first--;
+			}
+			common::parallel_blocks(nnz, num_threads, [&](uint64_t begin, uint64_t end, uint) {
+				for (uint64_t i = begin; i < end; i++) {
+					uint64_t key = 0;
+					for (int o = first + 1; o <= last; o++) {
+						key = key << bits[o] | labels[others[o]][coo.coordinates(others[o])[sorted[i]]];
+					}
+					keys[i] = key;
+				}
+			});
+			common::radix_sort(keys, sorted, key_bits, num_threads);
+			last = first;
+			passes++;
+		}
+	}
+
+	// 2 - The columns of every row in increasing order: a column starts wherever the other modes' labels change,
+	// which the sorted keys tell when a single key held all of them [a column appears once in a row even if nonzeros repeat]
+	const uint * rows = coo.coordinates(mode);
+	vector<uint64_t> row_begin(width + 1, 0);
+	for (uint64_t i = 0; i < nnz; i++) {
+		row_begin[rows[i] + 1]++;
+	}
+	for (uint row = 0; row < width; row++) {
+		row_begin[row + 1] += row_begin[row];
+	}
+	vector<uint64_t> row_end(row_begin.begin(), row_begin.end() - 1);
+	vector<Index> row_columns(nnz);
+	Index column = 0;
+	for (uint64_t i = 0; i < nnz; i++) {
+		if (i != 0 && passes == 1) {
+			column += keys[i] != keys[i - 1];
+		}
+		else if (i != 0) {
+			for (uint o = 0; o < others.size(); o++) {
+				const uint * coordinates = coo.coordinates(others[o]);
+				if (coordinates[sorted[i]] != coordinates[sorted[i - 1]]) {
+					column++;
+					break;
+				}
+			}
+		}
+		const uint row = rows[sorted[i]];
+		if (row_end[row] == row_begin[row] || row_columns[row_end[row] - 1] != column) {
+			row_columns[row_end[row]++] = column;
+		}
+	}
+
+	// 3 - Lexicographic order: the row holding the smaller column at the first difference comes first and
+	// a row that runs out of columns comes after the ones that go on, empty rows end up last.
+	// Equal rows keep the order of their current labels
+	const vector<uint> & current = labels[mode];
+	vector<uint> row_order(width);
+	for (uint row = 0; row < width; row++) {
+		row_order[row] = row;
+	}
+	sort(row_order.begin(), row_order.end(), [&](uint lhs, uint rhs) {
+		const Index * left = row_columns.data() + row_begin[lhs], * left_end = row_columns.data() + row_end[lhs];
+		const Index * right = row_columns.data() + row_begin[rhs], * right_end = row_columns.data() + row_end[rhs];
+		for (; left != left_end && right != right_end; left++, right++) {
+			if (*left != *right) {
+				return *left < *right;
+			}
+		}
+		if (left == left_end && right == right_end) {
+			return current[lhs] < current[rhs];
+		}
+		return right == right_end;
+	});
+	mode_labels.resize(width);
+	for (uint i = 0; i < width; i++) {
+		mode_labels[row_order[i]] = i;
+	}
+}
+}
@@ -0,0 +1,55 @@
+#ifndef _LEXI_ORDER_HPP
+#define _LEXI_ORDER_HPP
+
+#include <vector>
+#include <string>
+#include <exception>
+#include "../Tensor/tensor.hpp"
+
+namespace lexi
+{
+typedef unsigned int uint;
+
+// Lexi-Order: every mode is reordered by sorting its indices [the rows of the mode's matricization]
+// lexicographically by the columns they hold, a column being a distinct coordinate tuple of the other modes
+// read in their current labels. Rounds repeat this until no label changes or <rounds> are done.
+// A mode already sees the labels the modes before it got in the same round. All threads sort the
+// nonzeros of one mode, the result doesn't depend on their number. Works on the COO tensor directly, no graph is built
+class LexiOrder {
+public:
+	explicit LexiOrder(const tensor::CooTensor & coo, uint rounds = 5, uint num_threads = 0, bool verbose = false);
+
+	// new label of every vertex of the k-partite graph [vertex ids include the mode offsets, as convert numbers them]
+	const std::vector<uint> & computePermutation();
+	void write_permutation(const std::string & output_file) const; // the format relabel reads
+	const std::vector< std::vector<uint> > & mode_labels() const { return labels; }
+private:
+	const tensor::CooTensor & coo;
+	std::vector< std::vector<uint> > labels; // labels[m][c] is the current label of coordinate c of mode m
+	std::vector<uint> new_labels;
+	uint rounds;
+	uint num_threads;
+	bool verbose;
+
+	// <Index> holds a nonzero or column index, computePermutation picks the narrowest type that fits the nonzero count
+	template <typename Index>
+	void order_mode(uint mode, uint num_threads, std::vector<uint> & mode_labels) const;
+};
+
+// =====================
+// EXCEPTION CLASS BELOW
+// =====================
+
+class LexiException : public std::exception {
+public:
+	LexiException(const char * msg) : msg(msg) { }
+
+	const char * what() const noexcept {
+		return msg;
+	}
+private:
+	const char * msg;
+};
+}
+
+#endif
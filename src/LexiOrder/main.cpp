@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "lexi_order.hpp"
+#include "../Tensor/tensor.hpp"
+using namespace std;
+
+namespace lexi
+{
+void usage() {
+	cout << "Usage: PURE lexi TENSOR -[OPTIONS...]" << endl;
+}
+
+void help() {
+	cout << "Lexi-Order" << endl
+		<< "----------" << endl
+		<< "Orders every mode of the tensor by sorting its indices lexicographically by the coordinates of the" << endl
+		<< "other modes, round after round. The permutation has the format relabel reads, no graph is built" << endl;
+	usage();
+	cout << "Available options" << endl
+		<< "\t-o FILENAME\t\t name of the permutation file [default: lexi_permutation.txt]" << endl
+		<< "\t-rounds N\t\t largest number of rounds, fewer when the labels stop changing [default: 5]" << endl
+		<< "\t-threads N\t\t number of threads sorting the nonzeros of a mode" << endl
+		<< "\t-no_values \t\t tensor file does NOT contain values" << endl
+		<< "\t-v \t\t verbose mode" << endl;
+}
+
+int lexiMain(int argc, char * argv[]) {
+	cout << "************************************" << endl;
+	// 1 - parse the command line options
+	vector<string> arguments(argc);
+	for (int i = 0; i < argc; i++) {
+		arguments[i] = string(argv[i]);
+	}
+
+	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
+		help();
+		exit(0);
+	}
+	else if (argc < 2) {
+		usage();
+		exit(0);
+	}
+
+	bool values_exist = true, verbose = false;
+	uint num_threads = 0, rounds = 5;
+	string tensor_file, output_file = "lexi_permutation.txt";
+	for (int i = 1; i < argc; i++) {
+		if (arguments[i] == "-no_values") {
+			values_exist = false;
+		}
+		else if (arguments[i] == "-v") {
+			verbose = true;
+		}
+		else if (arguments[i] == "-o" || arguments[i] == "-rounds" || arguments[i] == "-threads") {
+			if (i + 1 >= argc || arguments[i + 1][0] == '-') {
+				cerr << "expected a value after " << arguments[i] << ", didn't find one!" << endl;
+				exit(1);
+			}
+			const string & value = arguments[++i];
+			if (arguments[i - 1] == "-o") {
+				output_file = value;
+			}
+			else if (arguments[i - 1] == "-rounds") {
+				rounds = atoi(value.c_str());
+			}
+			else {
+				num_threads = atoi(value.c_str());
+			}
+		}
+		else if (arguments[i][0] != '-' && tensor_file == "") {
+			tensor_file = arguments[i];
+		}
+		else { // unknown argument!
+			cerr << "Unknown argument encountered: " << arguments[i] << endl;
+			exit(1);
+		}
+	}
+
+	if (tensor_file == "") {
+		cerr << "A tensor file must be provided!" << endl;
+		exit(1);
+	}
+
+	// 2 - permutation
+	try {
+		tensor::CooTensor coo(tensor_file, values_exist, num_threads);
+		cout << "Read " << coo.nnz() << " nonzeros from the tensor file" << endl;
+		LexiOrder ordering(coo, rounds, num_threads, verbose);
+		ordering.computePermutation();
+		ordering.write_permutation(output_file);
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot read the tensor file " << tensor_file << ": " << exc.what() << endl;
+		exit(1);
+	}
+	catch (LexiException & exc) {
+		cerr << "Cannot order the tensor: " << exc.what() << endl;
+		exit(1);
+	}
+	cout << "************************************" << endl;
+	return 0;
+}
+}
@@ -25,6 +25,7 @@ void banner() {
 
 void usage() {
 	cout << "Usage: PURE GRAPH [OPTION...]" << endl
+		<< "GRAPH is either a graph written by convert or a MatrixMarket file" << endl
 		<< "PURE --help for more info" << endl;
 }
 
@@ -38,7 +39,8 @@ void help() {
 		<< "\t-symmetric \t\t for the edge (u, v) the file doesn't contain (v, u)" << endl
 		<< "\t-o=FILE_NAME \t\t name of the output file" << endl
 		<< "\t-no_write \t\t does NOT write the new permutation" << endl
-		<< "\t-weight_based \t\t weight based reordering" << endl;
+		<< "\t-weight_based \t\t weight based reordering" << endl
+		<< "\t-threads=N \t\t number of threads used for the traversal, -threads N is accepted too" << endl;
 }
 
 int RCMmain(int argc, char * argv[]) {
@@ -50,6 +52,7 @@ int RCMmain(int argc, char * argv[]) {
 	}
 
 	bool values_exist = false, symmetric = false, zero_based = false, write = true, degree_based = true;
+	uint num_threads = 0;
 	string input_filename, output_filename = "RCM_permutation.txt";
 
 	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
@@ -89,6 +92,12 @@ int RCMmain(int argc, char * argv[]) {
 			}
 			output_filename = it->substr(3);
 		}
+		else if (it->length() >= 9 && it->substr(0, 9) == "-threads=") {
+			num_threads = atoi(it->substr(9).c_str());
+		}
+		else if (*it == "-threads" && it + 1 != arguments.cend()) {
+			num_threads = atoi((++it)->c_str());
+		}
 		else if (it->at(0) != '-') {
 			input_filename = *it;
 		}
@@ -102,7 +111,7 @@ int RCMmain(int argc, char * argv[]) {
 	// 1 - RCM
 	try {	
 		banner();
-		rcm::RCM graph(input_filename, values_exist, symmetric, !zero_based, degree_based);
+		rcm::RCM graph(input_filename, values_exist, symmetric, !zero_based, degree_based, num_threads);
 		graph.relabel();
 		if (write) {
 			graph.printNewLabels(output_filename);
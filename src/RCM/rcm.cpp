@@ -1,173 +1,275 @@
 #include "rcm.hpp"
+#include "../Common/mapped_file.hpp"
+#include "../Common/text_parse.hpp"
+#include "../Common/parallel.hpp"
+#include "../RelabelTensor/relabel.hpp"
 #include <vector>
-#include <list>
-#include <queue>
 #include <algorithm>
 #include <iostream>
-#include <set>
-#include <climits>
 #include <chrono>
+#include <cmath>
 #include <utility>
 
 using namespace std;
 namespace rcm
 {
 
-RCM::RCM(string & iname, bool valuesExist, bool symmetric, bool oneBased, bool degree_based) 
-	: valuesExist(valuesExist), symmetric(symmetric), oneBased(oneBased), degree_based(degree_based) {
-	// MatrixMarket input format expected [without comments]
+RCM::RCM(string & iname, bool valuesExist, bool symmetric, bool oneBased, bool degree_based, uint num_threads) 
+	: valuesExist(valuesExist), symmetric(symmetric), oneBased(oneBased), degree_based(degree_based),
+	num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
 	ifstream is(iname);
 	if (!is.is_open()) throw InputFileErrorException();
+	string first_line;
+	getline(is, first_line);
+	is.close();
 
 	cout << "Started taking inputs" << endl;
 	auto begin = chrono::high_resolution_clock::now();
-	int vertexCount, edgeCount;
-	is >> vertexCount >> vertexCount >> edgeCount;
-	vertices.resize(vertexCount);
-	for (int i = 0; i < edgeCount; i++) {
-		int v1, v2;
-		float weight = 1;
-		if (valuesExist) {
-			is >> v1 >> v2 >> weight;
-		}
-		else {
-			is >> v1 >> v2;
-		}
-		
-		// Input check
-		int lowerBound = oneBased ? 1 : 0;
-		int upperBound = oneBased ? vertexCount : vertexCount - 1;
-
-		if (v1 < lowerBound || v1 > upperBound) 
-			throw VertexNotFound(v1);
-		if (v2 < lowerBound || v2 > upperBound)
-			throw VertexNotFound(v2);
-
-		insertEdge(v1, v2, weight);
-		if (symmetric) {
-			insertEdge(v2, v1, weight);
+	const bool binary = first_line.compare(0, sizeof(graph::GRAPH_MAGIC), graph::GRAPH_MAGIC, sizeof(graph::GRAPH_MAGIC)) == 0;
+	if (binary || (first_line.size() > 1 && first_line[0] == '%' && first_line[1] != '%')) {
+		// Graph written by convert [text or binary], each edge is listed once
+		try {
+			graph = graph::CSRGraph(iname, true);
 		}
+		catch (const graph::GraphFileException & exc) {
+			throw InputFileErrorException(exc.what());
+		}
+	}
+	else {
+		readMatrixMarket(iname);
 	}
-	
 	auto end = chrono::high_resolution_clock::now();
 	cout << "Input has been processed in " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms" << endl;
-
-	// Initialize the unvisited vertices set
-	for (int i = 0; i < vertexCount; i++) {
-		unmarkedVertices.insert(i);
-	}
 }
 
-void RCM::insertEdge(int v1, int v2, float weight) {
-	// Pre-condition: the new edge doesn't exist
-	if (oneBased) {
-		v1 -= 1;
-		v2 -= 1;
+RCM::RCM(graph::CSRGraph graph, bool degree_based, uint num_threads)
+	: graph(std::move(graph)), valuesExist(true), symmetric(true), oneBased(false), degree_based(degree_based),
+	num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) { }
+
+void RCM::readMatrixMarket(const string & iname) {
+	// MatrixMarket coordinate format expected, comment lines are skipped
+	vector<uint> sources, targets, weights;
+	uint64_t vertexCount = 0;
+	try {
+		common::MappedFile file(iname);
+		const char * position = file.data(), * end = file.data() + file.size();
+		while (position != end && !common::is_record(position, end)) {
+			position = common::next_line(position, end);
+		}
+
+		uint64_t rowCount, columnCount, edgeCount;
+		const char * line = position;
+		if (!common::parse_uint(line, end, rowCount) || !common::parse_uint(line, end, columnCount)
+			|| !common::parse_uint(line, end, edgeCount)) {
+			throw InputFileErrorException("MatrixMarket size line is missing");
+		}
+		vertexCount = max(rowCount, columnCount);
+		sources.reserve(edgeCount);
+		targets.reserve(edgeCount);
+		weights.reserve(edgeCount);
+
+		const uint64_t lowerBound = oneBased ? 1 : 0;
+		const uint64_t upperBound = oneBased ? vertexCount : vertexCount - 1;
+		for (position = common::next_line(position, end); position != end; position = common::next_line(position, end)) {
+			if (!common::is_record(position, end)) {
+				continue;
+			}
+			uint64_t v1, v2;
+			double weight = 1;
+			line = position;
+			if (!common::parse_uint(line, end, v1) || !common::parse_uint(line, end, v2)
+				|| (valuesExist && !common::parse_double(line, end, weight))) {
+				throw InputFileErrorException("Error during input parse");
+			}
+
+			// Input check
+			if (v1 < lowerBound || v1 > upperBound) 
+				throw VertexNotFound(v1);
+			if (v2 < lowerBound || v2 > upperBound)
+				throw VertexNotFound(v2);
+			if (weight < 0 || weight != floor(weight) || weight > UINT32_MAX)
+				throw InputFileErrorException("Edge weights must be non negative integers");
+
+			sources.push_back(static_cast<uint>(v1 - lowerBound));
+			targets.push_back(static_cast<uint>(v2 - lowerBound));
+			weights.push_back(static_cast<uint>(weight));
+		}
+	}
+	catch (const common::MappedFileException & exc) {
+		throw InputFileErrorException(exc.what());
 	}
-	pair<int, int> edge = { v1, weight };
-	vertices[v1].neighbors.push_back(edge);
+
+	graph = graph::CSRGraph(static_cast<uint>(vertexCount), sources, targets, weights, symmetric);
 }
 
 void RCM::relabel() {
-	// Pre-condition: At least 2 vertices exist in <vertices>
-
 	cout << "Started relabeling vertices" << endl;
 	auto begin = chrono::high_resolution_clock::now();
 
-	while (!unmarkedVertices.empty()) {
-		// 1 - Find the vertex having smallest degree / total degree weight
-		pair<int, float> smallDegreeVertex = { 0, INT_MAX }; // < label, degree >
-		for (vector<Vertex>::iterator it = vertices.begin(); it != vertices.end(); it++) {
+	const uint vertexCount = graph.num_vertices();
+	Comparator comp(*this);
 
-			if (degree_based && it->neighbors.size() < smallDegreeVertex.second && !it->visited) {
-				smallDegreeVertex = { (it - vertices.begin()), it->neighbors.size() };
-			}
-			else if (!degree_based) {
-				float weight_sum = 0;
-				for (list< pair<int, float> >::const_iterator neighbor = it->neighbors.cbegin(); neighbor != it->neighbors.cend(); neighbor++) {
-					weight_sum += neighbor->second;
-				}
-				if (weight_sum < smallDegreeVertex.second && !it->visited) {
-					smallDegreeVertex = { (it - vertices.begin()), weight_sum };
-				}
-			}
+	// 1 - Start vertices are taken in increasing order of degree / total degree weight,
+	// a counting sort over the degrees serves as the bucket queue
+	vector<uint> start_order(vertexCount);
+	if (degree_based) {
+		uint max_degree = 0;
+		for (uint v = 0; v < vertexCount; v++) {
+			max_degree = max(max_degree, graph.degree(v));
 		}
-
-		// 2 - For each vertex V, add to the list the neighors of V WRT increasing order of degree
-		vertices[smallDegreeVertex.first].visited = true;
-		unmarkedVertices.erase(smallDegreeVertex.first);
-		new_labels.push_back(smallDegreeVertex.first);
-		bool componentMarked = true; // will be false when all vertices belonging to a connected subgraph are marked
-		while (componentMarked) {
-			componentMarked = false;
-			Vertex & currentVertex = vertices[new_labels.front()];
-
-			// ===== Comparison & sorting =======
-			Comparator comp(*this);
-			currentVertex.neighbors.sort(comp); 
-			/* comparator function is a functor provided by the class [access to class members 
-			is required for the comparator to work - see RCM::operator()()]*/
-
-			for (list< pair<int, float> >::iterator it = currentVertex.neighbors.begin(); it != currentVertex.neighbors.end(); it++) {
-				if (!vertices[it->first].visited) {
-					vertices[it->first].visited = true;
-					componentMarked = true;
-					unmarkedVertices.erase(it->first);
-					new_labels.push_back(it->first);
-				}
-			}
+		vector<uint> bucket_offsets(static_cast<size_t>(max_degree) + 2, 0);
+		for (uint v = 0; v < vertexCount; v++) {
+			bucket_offsets[graph.degree(v) + 1]++;
+		}
+		for (uint degree = 0; degree <= max_degree; degree++) {
+			bucket_offsets[degree + 1] += bucket_offsets[degree];
 		}
+		for (uint v = 0; v < vertexCount; v++) {
+			start_order[bucket_offsets[graph.degree(v)]++] = v;
+		}
+	}
+	else { // weighted degrees are too spread for buckets, they are sorted once instead
+		for (uint v = 0; v < vertexCount; v++) {
+			start_order[v] = v;
+		}
+		sort(start_order.begin(), start_order.end(), comp);
+	}
+
+	// 2 - Breadth first traversal of each connected component from a pseudo-peripheral vertex,
+	// the unvisited neighbors of a vertex are labeled in increasing order of degree
+	if (num_threads > 1) {
+		cuthillMcKeeParallel(start_order);
+	}
+	else {
+		cuthillMcKee(start_order);
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	cout << "Vertices has been relabeled in " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms" << endl
 		<< "Reversing labels" << endl;
 
-	begin = chrono::high_resolution_clock::now();
-	
 	// 3 - Reverse the order of elements
-	list<int>::iterator front = new_labels.begin();
-	list<int>::reverse_iterator back = new_labels.rbegin();
-	int frontPosition = 0;
-	int backPosition = vertices.size() - 1;
-	while (frontPosition < backPosition) {
-		swap(*front, *back);
-		frontPosition++;
-		backPosition--;
-		front++;
-		back++;
-	}
-
+	begin = chrono::high_resolution_clock::now();
+	reverse(new_labels.begin(), new_labels.end());
 	end = chrono::high_resolution_clock::now();
 	cout << "Labels have been reversed in " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms" << endl;
 }
 
 void RCM::printNewLabels(string & oname) const {
-	ofstream os(oname);
 	cout << "Preparing the permutation file" << endl;
 	auto begin = chrono::high_resolution_clock::now();
 
-	for (list<int>::const_iterator it = new_labels.begin(); it != new_labels.end(); it++) {
-		os << *it << endl;
+	const vector<uint> & dimension_widths = graph.dimension_widths();
+	if (dimension_widths.empty()) {
+		// MatrixMarket input: the vertices in their new order, one per line
+		ofstream os(oname);
+		for (vector<uint>::const_iterator it = new_labels.begin(); it != new_labels.end(); it++) {
+			os << *it << '\n';
+		}
+	}
+	else {
+		// Tensor graph: the permutation file relabel expects, the new label of every vertex after the header
+		if (!relabel::write_permutation_file(oname, dimension_widths, permutation())) {
+			cerr << "Cannot write the permutation file " << oname << endl;
+		}
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	cout << "Permutation file has been prepared in " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms" << endl;
 }
 
-bool RCM::Comparator::operator()(const EDGE & lhs, const EDGE & rhs) {
-	if (!rcm_obj.degree_based) {
-		float sum_lhs = 0, sum_rhs = 0;
-		for (EDGE_LIST::const_iterator it = rcm_obj.vertices[lhs.first].neighbors.cbegin(); it != rcm_obj.vertices[lhs.first].neighbors.cend(); it++) {
-			sum_lhs += it->second;
+vector<uint> RCM::permutation() const {
+	vector<uint> labels(new_labels.size());
+	for (uint position = 0; position < new_labels.size(); position++) {
+		labels[new_labels[position]] = position;
+	}
+	return labels;
+}
+
+// Class RCM | Private Member Function Definitions
+
+void RCM::cuthillMcKee(const vector<uint> & start_order) {
+	const uint vertexCount = graph.num_vertices();
+	Comparator comp(*this);
+	new_labels.clear();
+	new_labels.reserve(vertexCount);
+
+	vector<char> visited(vertexCount, 0);
+	vector<uint> level_mark(vertexCount, 0);
+	uint stamp = 0;
+	vector<uint> children;
+	for (vector<uint>::const_iterator next_start = start_order.begin(); new_labels.size() < vertexCount; next_start++) {
+		if (visited[*next_start]) {
+			continue;
 		}
-		for (EDGE_LIST::const_iterator it = rcm_obj.vertices[rhs.first].neighbors.cbegin(); it != rcm_obj.vertices[rhs.first].neighbors.cend(); it++) {
-			sum_rhs += it->second;
+		const uint start = findStartVertex(*next_start, level_mark, stamp);
+		visited[start] = 1;
+		new_labels.push_back(start);
+
+		for (size_t head = new_labels.size() - 1; head < new_labels.size(); head++) {
+			const uint current = new_labels[head];
+			const uint * neighbors = graph.neighbors(current);
+			children.clear();
+			for (uint i = 0; i < graph.degree(current); i++) {
+				if (!visited[neighbors[i]]) {
+					visited[neighbors[i]] = 1;
+					children.push_back(neighbors[i]);
+				}
+			}
+			sort(children.begin(), children.end(), comp);
+			new_labels.insert(new_labels.end(), children.begin(), children.end());
 		}
-		return sum_lhs < sum_rhs;
 	}
-	else {
-		return rcm_obj.vertices[lhs.first].neighbors.size() < rcm_obj.vertices[rhs.first].neighbors.size();
+}
+
+uint RCM::findStartVertex(uint start, vector<uint> & level_mark, uint & stamp) const {
+	// George-Liu pseudo-peripheral vertex search: move to a smallest degree vertex of the deepest
+	// level of the level structure for as long as the eccentricity grows
+	vector<uint> last_level, candidate_last_level;
+	uint root = start;
+	uint eccentricity = levelStructure(root, level_mark, ++stamp, last_level);
+	while (true) {
+		const uint candidate = *min_element(last_level.begin(), last_level.end(), Comparator(*this));
+		const uint candidate_eccentricity = levelStructure(candidate, level_mark, ++stamp, candidate_last_level);
+		if (candidate_eccentricity <= eccentricity) {
+			break;
+		}
+		root = candidate;
+		eccentricity = candidate_eccentricity;
+		last_level.swap(candidate_last_level);
 	}
+	return root;
+}
+
+uint RCM::levelStructure(uint root, vector<uint> & level_mark, uint stamp, vector<uint> & last_level) const {
+	// Breadth first search from <root>, returns the depth & fills <last_level> with the deepest level
+	vector<uint> queue(1, root);
+	level_mark[root] = stamp;
+	uint depth = 0;
+	size_t level_begin = 0;
+	while (true) {
+		const size_t level_end = queue.size();
+		for (size_t head = level_begin; head < level_end; head++) {
+			const uint * neighbors = graph.neighbors(queue[head]);
+			for (uint i = 0; i < graph.degree(queue[head]); i++) {
+				if (level_mark[neighbors[i]] != stamp) {
+					level_mark[neighbors[i]] = stamp;
+					queue.push_back(neighbors[i]);
+				}
+			}
+		}
+		if (queue.size() == level_end) {
+			last_level.assign(queue.begin() + level_begin, queue.end());
+			return depth;
+		}
+		level_begin = level_end;
+		depth++;
+	}
+}
+
+bool RCM::Comparator::operator()(uint lhs, uint rhs) const {
+	// degrees & weighted degrees are both precomputed by the graph
+	const uint64_t key_lhs = rcm_obj.key(lhs), key_rhs = rcm_obj.key(rhs);
+	return key_lhs < key_rhs || (key_lhs == key_rhs && lhs < rhs);
 }
 }
@@ -2,54 +2,56 @@
 #define _RCM_H
 
 #include <vector>
-#include <queue>
-#include <list>
-#include <set>
+#include <string>
 #include <fstream>
 #include <exception>
 #include <utility>
+#include "../Graph/csr_graph.hpp"
 
 namespace rcm
 {
 
-typedef std::pair<int, float> EDGE; // < neighor, weight >
-typedef std::list< EDGE > EDGE_LIST;
-
+typedef unsigned int uint;
 
 class RCM {
 public:
-	// A graph is symmetric when it contains only the v1-v2 edge in undirected structure
-	explicit RCM(std::string & iname, bool valuesExist = false, bool symmetric = true, bool oneBased = true, bool degree_based = true);
+	// A graph is symmetric when it contains only the v1-v2 edge in undirected structure.
+	// Graphs written by convert [starting with the "% widths" header] are always read as symmetric
+	// and zero based, anything else is read as a MatrixMarket coordinate file.
+	// With more than one thread the traversal is level synchronous, the permutation stays the same
+	explicit RCM(std::string & iname, bool valuesExist = false, bool symmetric = true, bool oneBased = true, bool degree_based = true,
+		uint num_threads = 0);
+	// Graph already in memory [e.g. built by convert]
+	explicit RCM(graph::CSRGraph graph, bool degree_based = true, uint num_threads = 0);
 
-	void insertEdge(int v1, int v2, float weight);
 	void relabel();
 	void printNewLabels(std::string & oname) const;
+	std::vector<uint> permutation() const; // new label of every vertex, available after relabel()
 
 private:
-	struct Vertex {
-		Vertex() {
-			visited = false;
-		}
-
-		bool visited;
-		EDGE_LIST neighbors;
-	};
-
 	struct Comparator {
 		Comparator(const RCM & rcm_obj) : rcm_obj(rcm_obj) { }
-		bool operator() (const EDGE & lhs, const EDGE & rhs); // comparator as a functor
+		bool operator() (uint lhs, uint rhs) const; // comparator as a functor, ties are broken by the vertex label
 
 		const RCM & rcm_obj;
 	};
 
-	std::vector<Vertex> vertices;
-	std::set<int> unmarkedVertices;
-	std::list<int> new_labels;
+	graph::CSRGraph graph;
+	std::vector<uint> new_labels; // vertices in RCM order
 
 	bool valuesExist;
 	bool symmetric;
 	bool oneBased;
 	bool degree_based;
+	uint num_threads;
+
+	void readMatrixMarket(const std::string & iname);
+
+	uint64_t key(uint v) const { return degree_based ? graph.degree(v) : graph.weighted_degree(v); }
+	uint findStartVertex(uint start, std::vector<uint> & level_mark, uint & stamp) const;
+	uint levelStructure(uint root, std::vector<uint> & level_mark, uint stamp, std::vector<uint> & last_level) const;
+	void cuthillMcKee(const std::vector<uint> & start_order);
+	void cuthillMcKeeParallel(const std::vector<uint> & start_order); // defined in rcm_parallel.cpp
 };
 
 // =======================
@@ -75,7 +77,7 @@ public:
 
 class VertexNotFound : public InputFileErrorException {
 public:
-	VertexNotFound(int id) : InputFileErrorException(std::string("Invalid vertex encountered: " + id).c_str()) {}
+	VertexNotFound(int id) : InputFileErrorException("Invalid vertex encountered") {}
 };
 }
 
@@ -0,0 +1,240 @@
+#include "rcm.hpp"
+#include "../Common/parallel.hpp"
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <climits>
+
+using namespace std;
+namespace rcm
+{
+
+namespace
+{
+const uint NONE = UINT_MAX;
+const uint PARALLEL_LEVEL = 1024; // smaller levels are expanded by thread 0 alone, a team round costs two barriers
+
+// Lowers <target> to <value>, returns true for the thread that found <target> unclaimed
+inline bool claim(atomic<uint> & target, uint value) {
+	uint current = target.load(memory_order_relaxed);
+	while (value < current) {
+		if (target.compare_exchange_weak(current, value, memory_order_relaxed)) {
+			return current == NONE;
+		}
+	}
+	return false;
+}
+
+// Start of the <thread_id>th block when [begin, end) is split between <num_threads> threads
+inline uint block_start(uint begin, uint end, uint thread_id, uint num_threads) {
+	return begin + static_cast<uint>(static_cast<uint64_t>(end - begin) * thread_id / num_threads);
+}
+}
+
+// Level synchronous Cuthill-McKee. Thread 0 drives the traversal, the other threads only join the
+// levels that are large enough to be split. The serial traversal appends the children of a frontier
+// vertex right after the children of the previous frontier vertex, so an unvisited vertex belongs to
+// the leftmost frontier vertex it is adjacent to. A large level is computed as
+//   A - unvisited neighbors claim the smallest frontier position they are adjacent to (atomic min)
+//   B - children are counted per frontier position
+//   C - a prefix sum over the counts gives the place of each child list in the new level (thread 0)
+//   D - children are scattered to their lists
+//   E - each list is sorted by degree / weighted degree, which reproduces the serial permutation
+void RCM::cuthillMcKeeParallel(const vector<uint> & start_order) {
+	const uint vertexCount = graph.num_vertices();
+	Comparator comp(*this);
+	new_labels.assign(vertexCount, 0);
+
+	vector<char> visited(vertexCount, 0);
+	vector< atomic<uint> > parent(vertexCount);     // frontier position of the vertex that labels it
+	vector< atomic<uint> > child_end(vertexCount);  // per frontier position: child count, then scatter cursor
+	vector<uint> child_begin(vertexCount);
+	vector< atomic<uint> > level_mark(vertexCount); // George-Liu searches, stamped like the serial version
+	common::parallel_blocks(vertexCount, num_threads, [&](uint64_t begin, uint64_t end, uint) {
+		for (uint64_t v = begin; v < end; v++) {
+			parent[v].store(NONE, memory_order_relaxed);
+			child_end[v].store(0, memory_order_relaxed);
+			level_mark[v].store(0, memory_order_relaxed);
+		}
+	});
+
+	vector< vector<uint> > discovered(num_threads);
+	common::Barrier barrier(num_threads);
+	function<void(uint)> phase;
+	bool finished = false;
+
+	// Runs <body(thread_id)> on every thread of the team
+	auto team = [&](const function<void(uint)> & body) {
+		phase = body;
+		barrier.wait();
+		phase(0);
+		barrier.wait();
+	};
+
+	// Breadth first search from <root>, returns the depth & leaves the deepest level in queue[last_begin, last_end)
+	vector<uint> queue;
+	uint stamp = 0;
+	auto level_structure = [&](uint root, size_t & last_begin, size_t & last_end) -> uint {
+		const uint current_stamp = ++stamp;
+		level_mark[root].store(current_stamp, memory_order_relaxed);
+		queue.assign(1, root);
+		size_t level_begin = 0;
+		uint depth = 0;
+		while (true) {
+			const uint level_end = queue.size();
+			auto expand = [&](uint begin, uint end, vector<uint> & next) {
+				for (uint head = begin; head < end; head++) {
+					const uint * neighbors = graph.neighbors(queue[head]);
+					for (uint i = 0; i < graph.degree(queue[head]); i++) {
+						atomic<uint> & mark = level_mark[neighbors[i]];
+						if (mark.load(memory_order_relaxed) != current_stamp
+							&& mark.exchange(current_stamp, memory_order_relaxed) != current_stamp) {
+							next.push_back(neighbors[i]);
+						}
+					}
+				}
+			};
+			if (level_end - level_begin < PARALLEL_LEVEL) {
+				expand(level_begin, level_end, queue);
+			}
+			else {
+				team([&](uint thread_id) {
+					expand(block_start(level_begin, level_end, thread_id, num_threads),
+						block_start(level_begin, level_end, thread_id + 1, num_threads), discovered[thread_id]);
+				});
+				for (uint t = 0; t < num_threads; t++) {
+					queue.insert(queue.end(), discovered[t].begin(), discovered[t].end());
+					discovered[t].clear();
+				}
+			}
+			if (queue.size() == level_end) {
+				last_begin = level_begin;
+				last_end = level_end;
+				return depth;
+			}
+			level_begin = level_end;
+			depth++;
+		}
+	};
+
+	// Same George-Liu search as findStartVertex, the deepest level is only kept in the queue
+	auto find_start_vertex = [&](uint start) -> uint {
+		size_t last_begin, last_end;
+		uint root = start;
+		uint eccentricity = level_structure(root, last_begin, last_end);
+		while (true) {
+			const uint candidate = *min_element(queue.begin() + last_begin, queue.begin() + last_end, comp);
+			const uint candidate_eccentricity = level_structure(candidate, last_begin, last_end);
+			if (candidate_eccentricity <= eccentricity) {
+				return root;
+			}
+			root = candidate;
+			eccentricity = candidate_eccentricity;
+		}
+	};
+
+	// Expands the level new_labels[level_begin, level_end) & returns the end of the next level
+	vector<uint> children;
+	auto expand_level = [&](uint level_begin, uint level_end) -> uint {
+		uint next_level_end = level_end;
+		if (level_end - level_begin < PARALLEL_LEVEL) {
+			for (uint position = level_begin; position < level_end; position++) {
+				const uint current = new_labels[position];
+				const uint * neighbors = graph.neighbors(current);
+				children.clear();
+				for (uint i = 0; i < graph.degree(current); i++) {
+					if (!visited[neighbors[i]]) {
+						visited[neighbors[i]] = 1;
+						children.push_back(neighbors[i]);
+					}
+				}
+				sort(children.begin(), children.end(), comp);
+				copy(children.begin(), children.end(), new_labels.begin() + next_level_end);
+				next_level_end += children.size();
+			}
+			return next_level_end;
+		}
+
+		// A - claim the unvisited neighbors, B - count the children of each frontier vertex
+		team([&](uint thread_id) {
+			vector<uint> & local = discovered[thread_id];
+			const uint block_end = block_start(level_begin, level_end, thread_id + 1, num_threads);
+			for (uint position = block_start(level_begin, level_end, thread_id, num_threads); position < block_end; position++) {
+				const uint current = new_labels[position];
+				const uint * neighbors = graph.neighbors(current);
+				for (uint i = 0; i < graph.degree(current); i++) {
+					if (!visited[neighbors[i]] && claim(parent[neighbors[i]], position)) {
+						local.push_back(neighbors[i]);
+					}
+				}
+			}
+		});
+		team([&](uint thread_id) {
+			const vector<uint> & local = discovered[thread_id];
+			for (vector<uint>::const_iterator it = local.begin(); it != local.end(); it++) {
+				child_end[parent[*it].load(memory_order_relaxed)].fetch_add(1, memory_order_relaxed);
+			}
+		});
+
+		// C - place the child lists one after another
+		for (uint position = level_begin; position < level_end; position++) {
+			const uint count = child_end[position].load(memory_order_relaxed);
+			child_begin[position] = next_level_end;
+			child_end[position].store(next_level_end, memory_order_relaxed);
+			next_level_end += count;
+		}
+
+		// D - scatter, E - order every child list
+		team([&](uint thread_id) {
+			vector<uint> & local = discovered[thread_id];
+			for (vector<uint>::const_iterator it = local.begin(); it != local.end(); it++) {
+				new_labels[child_end[parent[*it].load(memory_order_relaxed)].fetch_add(1, memory_order_relaxed)] = *it;
+				visited[*it] = 1;
+			}
+			local.clear();
+		});
+		team([&](uint thread_id) {
+			const uint block_end = block_start(level_begin, level_end, thread_id + 1, num_threads);
+			for (uint position = block_start(level_begin, level_end, thread_id, num_threads); position < block_end; position++) {
+				sort(new_labels.begin() + child_begin[position],
+					new_labels.begin() + child_end[position].load(memory_order_relaxed), comp);
+			}
+		});
+		return next_level_end;
+	};
+
+	common::run_threads(num_threads, [&](uint thread_id) {
+		if (thread_id != 0) {
+			while (true) {
+				barrier.wait();
+				if (finished) {
+					return;
+				}
+				phase(thread_id);
+				barrier.wait();
+			}
+		}
+
+		uint labeled = 0;
+		for (vector<uint>::const_iterator next_start = start_order.begin(); labeled < vertexCount; next_start++) {
+			if (visited[*next_start]) {
+				continue;
+			}
+			const uint start = find_start_vertex(*next_start);
+			visited[start] = 1;
+			new_labels[labeled] = start;
+
+			uint level_begin = labeled, level_end = labeled + 1;
+			while (level_begin < level_end) {
+				const uint next_level_end = expand_level(level_begin, level_end);
+				level_begin = level_end;
+				level_end = next_level_end;
+			}
+			labeled = level_end;
+		}
+		finished = true;
+		barrier.wait();
+	});
+}
+}
@@ -1,86 +1,85 @@
 #include "dendrogram.hpp"
-#include <iostream>
+#include "../Common/parallel.hpp"
 #include <vector>
-#include <list>
-#include <cassert>
+#include <atomic>
 #include <stack>
 using namespace std;
 
 namespace rabbit
 {
-Dendrogram::Dendrogram(uint nodeCount) : nodeCount(nodeCount) {
-	for (uint i = 0; i < nodeCount; i++) {
-		vertices.push_back(Vertex(i));
-	}
-	new_id = nodeCount;
-}
+Dendrogram::Dendrogram(uint nodeCount)
+	: parent(nodeCount == 0 ? 0 : 2 * static_cast<size_t>(nodeCount) - 1, NONE),
+	children(nodeCount == 0 ? 0 : nodeCount - 1), nodeCount(nodeCount), new_id(nodeCount) { }
 
-Dendrogram::Dendrogram() {
+Dendrogram::Dendrogram() : nodeCount(0), new_id(0) {
 	// Creates an empty dendrogram with no vertices [should be used for initializing only!]
-	new_id = nodeCount;
+}
+
+Dendrogram & Dendrogram::operator=(const Dendrogram & rhs) {
+	parent = rhs.parent;
+	children = rhs.children;
+	nodeCount = rhs.nodeCount;
+	new_id.store(rhs.new_id.load());
+	return *this;
 }
 
 // Class Dendrogram | Public Member Function Definitions
 
-vector<uint> * Dendrogram::DFS() {
-	// The returned vector contains the old label for the new label i at position i
+vector<uint> * Dendrogram::DFS(uint num_threads) {
+	// The returned vector contains the new label of vertex i at position i
+	const uint total_count = new_id.load();
 
-	// 1 - keep a list of vertices with no parent (community roots)
-	stack<list<Vertex>::iterator> communities;
-	for (list<Vertex>::iterator iter = vertices.begin(); iter != vertices.end(); iter++) {
-		if (!iter->hasParent) {
-			communities.push(iter);
+	// 1 - Count the leaves below every vertex, children are labeled lower than their parent
+	vector<uint> leaf_count(total_count, 1);
+	for (uint label = nodeCount; label < total_count; label++) {
+		const Children & edges = children[label - nodeCount];
+		leaf_count[label] = leaf_count[edges.edge1] + leaf_count[edges.edge2];
+	}
+
+	// 2 - Each community root gets the range of labels starting at the prefix sum of the preceding roots
+	// [roots are numbered in decreasing order of their label]
+	vector<uint> communities;
+	vector<uint> first_label;
+	uint labelIncrement = 0;
+	for (uint label = total_count; label-- > 0; ) {
+		if (parent[label] == NONE) {
+			communities.push_back(label);
+			first_label.push_back(labelIncrement);
+			labelIncrement += leaf_count[label];
 		}
 	}
 
-	// 2 - while the list is not empty, get one community root and perform DFS starting from it
+	// 3 - Communities are independent, each one is numbered by an iterative DFS of its own
 	vector<uint> * DFSorder = new vector<uint>(nodeCount);
-	int labelIncrement = 0;
-	while (!communities.empty()) {
-		list<Vertex>::iterator current_community = communities.top();
-		communities.pop();
-
-		// Iterative DFS implementation below
-		stack<list<Vertex>::iterator> DFSstack;
-		DFSstack.push(current_community);
-		while (!DFSstack.empty()) {
-			list<Vertex>::iterator current_top = DFSstack.top();
-			current_top->visited = true;
-
-			// If current vertex is a leaf, relabel the vertex
-			if (!current_top->hasChildren) { // if edge1 is empty, edge2 must be empty as well
-				(*DFSorder)[current_top->label] = labelIncrement++; // assign new label
-				DFSstack.pop();
-			}
-			else if (!current_top->edge1->visited) {
-				DFSstack.push(current_top->edge1);
-			}
-			else if (!current_top->edge2->visited) {
-				DFSstack.push(current_top->edge2);
-			}
-			else { // vertex has two visited children
+	atomic<uint> next_community(0);
+	common::run_threads(num_threads, [&](uint) {
+		stack< pair<uint, uint> > DFSstack; // < vertex, first label of its subtree >
+		for (uint community = next_community++; community < communities.size(); community = next_community++) {
+			DFSstack.push({ communities[community], first_label[community] });
+			while (!DFSstack.empty()) {
+				const pair<uint, uint> current_top = DFSstack.top();
 				DFSstack.pop();
+
+				// If current vertex is a leaf, relabel the vertex
+				if (current_top.first < nodeCount) {
+					(*DFSorder)[current_top.first] = current_top.second; // assign new label
+					continue;
+				}
+				const Children & edges = children[current_top.first - nodeCount];
+				DFSstack.push({ edges.edge2, current_top.second + leaf_count[edges.edge1] });
+				DFSstack.push({ edges.edge1, current_top.second });
 			}
 		}
-	}
+	});
 	return DFSorder;
 }
 
-void Dendrogram::connect(uint u, uint v) {
-	// Precondition: <u> and <v> exist in the dendrogram && <u> and <v> are distinct vertices
-	Vertex newVertex = Vertex(new_id++);
-
-	list<Vertex>::iterator u_ptr, v_ptr;
-	for (list<Vertex>::iterator it = vertices.begin(); it != vertices.end(); it++) {
-		if (it->label == u) u_ptr = it;
-		else if (it->label == v) v_ptr = it;
-	}
-
-	newVertex.edge1 = u_ptr;
-	newVertex.edge2 = v_ptr;
-	newVertex.hasChildren = true;
-	u_ptr->hasParent = true;
-	v_ptr->hasParent = true;
-	vertices.push_back(newVertex);
+uint Dendrogram::connect(uint u, uint v) {
+	// Precondition: <u> and <v> exist in the dendrogram && <u> and <v> are distinct community roots
+	const uint label = new_id.fetch_add(1);
+	children[label - nodeCount] = { u, v };
+	parent[u] = label;
+	parent[v] = label;
+	return label;
 }
 }
@@ -2,43 +2,37 @@
 #define _DENDROGRAM_H
 
 #include <vector>
-#include <list>
-#include <set>
+#include <atomic>
 
 namespace rabbit
 {
 typedef unsigned int uint;
 
+// Binary merge tree of the communities. Leaves are the vertices [0, nodeCount),
+// every connect() adds an internal vertex labeled nodeCount, nodeCount + 1, ...
+// so children always have smaller labels than their parent
 class Dendrogram {
 public:
 	Dendrogram();
 	Dendrogram(uint nodeCount);
+	Dendrogram & operator=(const Dendrogram & rhs);
 
-	void connect(uint u, uint v);
-	std::vector<uint> * DFS();
+	uint connect(uint u, uint v); // returns the label of the new vertex joining <u> & <v>, safe to call concurrently
+	std::vector<uint> * DFS(uint num_threads = 1);
 	// Returns DFS order for each community in a vector,
 	// arr[i] contains the new label for i'th vertex
 private:
-	struct Vertex {
-		Vertex(uint label)
-			: label(label), hasParent(false), visited(false), hasChildren(false) { }
-		int label;
-		// In a dendrogram, a vertex is allowed to
-		// be connected to at most 2 vertices
-		std::list<Vertex>::iterator edge1;
-		std::list<Vertex>::iterator edge2;
-		bool hasParent;
-		bool hasChildren; // iterators aren't nullable, this is needed
-		bool visited;
+	static const uint NONE = 0xFFFFFFFF;
 
-		bool operator == (const Vertex & rhs) {
-			return this->label == rhs.label;
-		}
+	struct Children {
+		uint edge1; // visited first by the DFS
+		uint edge2;
 	};
 
-	std::list<Vertex> vertices;
+	std::vector<uint> parent; // NONE for community roots
+	std::vector<Children> children; // children of internal vertex <label> are at [label - nodeCount]
 	uint nodeCount;
-	uint new_id;
+	std::atomic<uint> new_id;
 };
 }
 
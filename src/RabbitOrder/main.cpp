@@ -14,7 +14,8 @@ void help() {
 		<< "\t-one_based \t\t vertices are labeled one based" << endl
 		<< "\t-not_symmetric \t\t for the edge (u, v) the file doesn't contain (v, u)" << endl
 		<< "\t-o=FILE_NAME \t\t name of the output file" << endl
-		<< "\t-write_graph \t\t writes the re-ordered graph in MatrixMarket format" << endl;
+		<< "\t-write_graph \t\t writes the re-ordered graph in MatrixMarket format" << endl
+		<< "\t-threads=N \t\t number of threads used for community detection" << endl;
 }
 
 int rabbitMain(int argc, char * argv[]) {
@@ -25,6 +26,7 @@ int rabbitMain(int argc, char * argv[]) {
 	}
 
 	bool valuesExist = false, symmetric = true, oneBased = false, writeGraph = false;
+	uint num_threads = 0;
 	string input_filename, output_filename = "rabbit_permutation.txt";
 
 	if (find(begin(arguments), end(arguments), "-symmetric") != end(arguments)) {
@@ -55,18 +57,22 @@ int rabbitMain(int argc, char * argv[]) {
 			}
 			output_filename = it->substr(3);
 		}
+		else if (it->length() >= 9 && it->substr(0, 9) == "-threads=") {
+			num_threads = atoi(it->substr(9).c_str());
+		}
 		if (it->at(0) != '-') {
 			input_filename = *it;
 		}
 	}
 	try {
 
-		Ordering graph(input_filename, symmetric, !oneBased, writeGraph);
+		Ordering graph(input_filename, symmetric, !oneBased, writeGraph, num_threads);
 		graph.rabbitOrder(output_filename);
 	}
 	catch (GraphException & exc) {
 		cout << "Error occured:" << endl
 			<< exc.what() << endl;
 	}
+	return 0;
 }
 }
@@ -1,16 +1,16 @@
 #include "ordering.hpp"
+#include "../Common/parallel.hpp"
+#include "../RelabelTensor/relabel.hpp"
 #include <iostream>
-#include <set>
 #include <cassert>
-#include <list>
 #include <vector>
 #include <algorithm>
 #include <fstream>
-#include <queue>
-#include <limits.h>
 #include <chrono>
 #include <string>
-#include <sstream>
+#include <atomic>
+#include <thread>
+#include <utility>
 
 using namespace std;
 namespace rabbit
@@ -18,10 +18,8 @@ namespace rabbit
 
 // Class Ordering
 
-uint Ordering::Vertex::labelCounter = 0;
-
-Ordering::Ordering(string filename, bool symmetric, bool zero_based, bool write_graph) 
-	: symmetric(symmetric), valuesExist(valuesExist), writeGraph(write_graph)  {
+Ordering::Ordering(string filename, bool symmetric, bool zero_based, bool write_graph, uint num_threads)
+	: symmetric(symmetric), writeGraph(write_graph), num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
 	/* Input Format: first two lines contain header info [dimension widhts & # of edges]
 	 * First line: % width1 width2 ... widthN
 	 * Second line: #_of_edges
@@ -29,106 +27,36 @@ Ordering::Ordering(string filename, bool symmetric, bool zero_based, bool write_
 	 */
 
 	chrono::high_resolution_clock::time_point begin, end;
-
-	// 1 - Create the input stream
-	ifstream is(filename);
-	if (!is.is_open()) {
-		throw InputFileErrorException();
-	}
 	cout << "Start: read the graph file" << endl;
-
 	begin = chrono::high_resolution_clock::now();
 
-	// 2 - read the first line [header info] & set values of member variables
-	string line_buffer;
-	getline(is, line_buffer);
-	num_vertices = 0;
-	if (line_buffer[0] != '%') {
-		cerr << "Graph file is incompatible - header info not found" << endl;
-	}
-	istringstream iss(line_buffer);
-	iss >> line_buffer;
-	while (!iss.eof()) {
-		string current_width;
-		iss >> current_width;
-		try {
-			num_vertices += stoi(current_width);
-			dimension_widths.push_back(stoi(current_width));
-		}
-		catch (...) {
-			break;
-		}
+	try {
+		graph = graph::CSRGraph(filename, symmetric);
 	}
-
-	getline(is, line_buffer);
-	if (line_buffer[0] != '%') {
-		cerr << "Graph file is incompatible - header info not found" << endl;
+	catch (const graph::GraphFileException & exc) {
+		throw InputFileErrorException(exc.what());
 	}
-	iss = istringstream(line_buffer);
-	iss >> line_buffer; // read the "%" out
-	iss >> num_edges;
-	vertices.resize(num_vertices);
-	new_id = num_vertices;
+	num_vertices = graph.num_vertices();
 	dendrogram = Dendrogram(num_vertices);
-	cout << num_vertices << " vertices " << num_edges << " edges" << endl;
-	
-	// 3 - read the edges of the graph
-	uint num_edges_read = 0;
-	for (uint current_edge = 0; !is.eof(); current_edge++, num_edges_read++) {
-		string vertex1, vertex2, weight; // weight is also provided as unsigned integers, always
-		/*
-		if (is.eof())
-		  break; // possible bug [not reading the last line] - but needed
-		 */
-
-		if (is.fail()) {
-		  cerr << "input stream failed" << endl;
-		  throw InvalidInputException();
-		}
-
-		try {
-			is >> vertex1 >> vertex2 >> weight;
-			insertEdge(stoi(vertex1), stoi(vertex2), stoi(weight));
-			if (symmetric) {
-				insertEdge(stoi(vertex2), stoi(vertex1), stoi(weight));
-			}
-		}
-		catch (...) {
-			break;
-		}
-	}
-
-	if (num_edges_read != num_edges) {
-		cerr << "Graph file has fewer edges than expected" << endl;
-	}
+	cout << num_vertices << " vertices " << graph.num_edges() << " edges" << endl;
 
 	end = chrono::high_resolution_clock::now();
 	cout << "End: read the graph file [" << 
 		chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
 }
 
-// Class Ordering | Public Member Function Definitions
-
-void Ordering::insertEdge(uint from, uint to, uint value) {
-	// 0 - Ensure that <from> exists among the vertices
-  if (from >= vertices.size() || from < 0) {
-		throw NotFoundException(VERTEX_NOT_FOUND);
-  }
-
-	vertices[from].edges.insert({ to, value });
+Ordering::Ordering(graph::CSRGraph graph, uint num_threads)
+	: symmetric(true), writeGraph(false), num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
+	this->graph = std::move(graph);
+	num_vertices = this->graph.num_vertices();
+	dendrogram = Dendrogram(num_vertices);
+	cout << num_vertices << " vertices " << this->graph.num_edges() << " edges" << endl;
 }
 
-void Ordering::rabbitOrder(const string output_filename) {
-	// 0 - Copy the graph [if necessary]
+// Class Ordering | Public Member Function Definitions
+
+const vector<uint> & Ordering::computePermutation() {
 	chrono::high_resolution_clock::time_point begin, end;
-	vector<Vertex> original_graph;
-	if (writeGraph) {
-		cout << "Start: prepare a copy of the original graph" << endl;
-		begin = chrono::high_resolution_clock::now();
-		original_graph = vertices;
-		end = chrono::high_resolution_clock::now();
-		cout << "End: prepare a copy of the original graph [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
-	}
 
 	// 1 - Community Detection
 	cout << "Start: community detection" << endl;
@@ -140,28 +68,27 @@ void Ordering::rabbitOrder(const string output_filename) {
 	// 2- Ordering Generation
 	cout << "Start: ordering generation" << endl;
 	begin = chrono::high_resolution_clock::now();
-	new_labels = *ordering_generation(); // memory leak
+	vector<uint> * labels = ordering_generation();
+	new_labels.swap(*labels);
+	delete labels;
 	end = chrono::high_resolution_clock::now();
 
 	cout << "End: ordering generation ["
-		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl
-		<< "Start: write the permutation file" << endl;
-
-	// 3 - Write output
-	ofstream os(output_filename);
-	// 3.1 - write out header info
-	os << "% ";
-	for (int i = 0; i < dimension_widths.size(); i++) {
-		os << dimension_widths[i] << " ";
-	}
-	os << endl << "% " << num_vertices << endl;
-	// 3.2 - write new labels seperated by spaces
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+	return new_labels;
+}
+
+void Ordering::rabbitOrder(const string output_filename) {
+	chrono::high_resolution_clock::time_point begin, end;
+	computePermutation();
+	cout << "Start: write the permutation file" << endl;
+
+	// 3 - Write output: the header with the dimension widths, then the new labels
 	begin = chrono::high_resolution_clock::now();
-	for (vector<uint>::const_iterator it = new_labels.begin(); it != new_labels.end(); it++) {
-	  os << *it << " ";
+	if (!relabel::write_permutation_file(output_filename, graph.dimension_widths(), new_labels)) {
+		cerr << "Cannot write the permutation file " << output_filename << endl;
 	}
 	end = chrono::high_resolution_clock::now();
-	os.close();
 
 	cout << "End: write the permutation file [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
 
@@ -169,22 +96,19 @@ void Ordering::rabbitOrder(const string output_filename) {
 		return;
 
 	// Outputs asymmetrical graph (i.e. outputs all edges of the graph)
+	// the adjacency is never modified during community detection, so it still is the original graph
 
 	cout << "Start: write the reordered graph" << endl;
 	begin = chrono::high_resolution_clock::now();
-	uint old_label = 0;
-	for (vector<uint>::const_iterator it = new_labels.begin(); it != new_labels.end(); it++, old_label++) {
-		Vertex & currentVertex = vertices[old_label];
-		currentVertex.label = *it;
-	}
-	cout << "End: write the reordered graph" << endl;
-
 	ofstream orderedStream("ordered_graph.txt");
-	for (vector<Vertex>::const_iterator it = vertices.begin(); it != vertices.end(); it++) {
-		for (unordered_map<uint, uint>::const_iterator edge = it->edges.begin(); edge != it->edges.end(); edge++) {
-			orderedStream << it->label << " " << vertices[edge->first].label << " " << edge->second << endl;
+	for (uint u = 0; u < num_vertices; u++) {
+		const uint * neighbors = graph.neighbors(u);
+		const uint * weights = graph.weights(u);
+		for (uint i = 0; i < graph.degree(u); i++) {
+			orderedStream << new_labels[u] << " " << new_labels[neighbors[i]] << " " << weights[i] << '\n';
 		}
 	}
+	cout << "End: write the reordered graph" << endl;
 	
 	end = chrono::high_resolution_clock::now();
 	cout << "Ordered graph file has been saved in " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms" << endl;
@@ -192,115 +116,218 @@ void Ordering::rabbitOrder(const string output_filename) {
 
 // Class Ordering | Private Member Function Definitions
 
+bool Ordering::processVertex(uint u, vector<Edge> & edges) {
+	// 0 - Take ownership of <u>, a thread merging into <u> holds it only briefly
+	uint64_t u_strength = communities[u].strength.exchange(INVALID_STRENGTH, memory_order_acquire);
+	while (u_strength == INVALID_STRENGTH) {
+		this_thread::yield();
+		u_strength = communities[u].strength.exchange(INVALID_STRENGTH, memory_order_acquire);
+	}
+	communities[u].processed = true;
+
+	// 1 - Collect the edges of the community & find the neighbor with the largest modularity gain
+	// [a neighbor owned by another thread at the moment isn't considered]
+	aggregate(u, edges);
+	std::pair<uint, double> maxModularityNeighbor = { NONE, 0.0 }; // < vertex_label, modularity >
+	for (vector<Edge>::const_iterator edge = edges.begin(); edge != edges.end(); edge++) {
+		const uint64_t v_strength = communities[edge->toVertex].strength.load(memory_order_relaxed);
+		if (v_strength == INVALID_STRENGTH) {
+			continue;
+		}
+		double currentModularity = modularity(u_strength, v_strength, edge->weight);
+		if (currentModularity > maxModularityNeighbor.second) {
+			maxModularityNeighbor = { edge->toVertex, currentModularity };
+		}
+	}
+	if (maxModularityNeighbor.first == NONE) { // <u> stays as a top level community
+		communities[u].strength.store(u_strength, memory_order_release);
+		return true;
+	}
+
+	// 2 - Merge into the best neighbor unless another thread owns it or has merged it meanwhile
+	const uint v = maxModularityNeighbor.first;
+	uint64_t v_strength = communities[v].strength.load(memory_order_relaxed);
+	if (v_strength == INVALID_STRENGTH
+		|| !communities[v].strength.compare_exchange_strong(v_strength, INVALID_STRENGTH, memory_order_acquire)) {
+		// the edges of the members are gone from aggregated[], the retry starts from the collected ones
+		// and vertices merging into <u> meanwhile have to keep theirs
+		aggregated[u].swap(edges);
+		communities[u].saved = true;
+		communities[u].processed = false;
+		communities[u].strength.store(u_strength, memory_order_release);
+		return false;
+	}
+	aggregated[u].swap(edges); // kept for the aggregation of <v>
+	mergeVertices(u, v);
+	communities[v].strength.store(v_strength + u_strength, memory_order_release); // <u> stays INVALID_STRENGTH
+	return true;
+}
+
 void Ordering::mergeVertices(uint u, uint v) {
-	// Pre-condition: u and v are neighbors OR u and v are the identical
-	// Post-condition: vertex <v> is merged into <u>
+	// Pre-condition: the calling thread owns both <u> and <v>, aggregated[u] holds the edges of <u>
+	// Post-condition: community <u> is merged into <v>
 
 	// 0 - If <u> and <v> are identical, no merge operation will be performed
 	if (u == v) return;
 
-	// 1 - Relable the vertex that's being merged on to ( <v> --> <v'> )
-	vertices[v].label = new_id++;
+	// 1 - Attach <u> to the members of <v>
+	Community & u_community = communities[u], & v_community = communities[v];
+	u_community.sibling = v_community.child.load(memory_order_relaxed);
+	v_community.child.store(u, memory_order_release);
+	u_community.dest.store(v, memory_order_release);
 
-	auto & u_edges = vertices[u].edges, &v_edges = vertices[v].edges;
-	// 2 - Reconnect edges connected to <u>, to <v'>
-	for (auto it = u_edges.begin(); it != u_edges.end(); it++) {
-		int neighbor_id = it->first;
-		if (neighbor_id == v || neighbor_id == u) {
-			continue;
-		}
+	// 2 - A new dendrogram vertex joins the two communities
+	v_community.node = dendrogram.connect(u_community.node, v_community.node);
 
-		auto & neighbor_edges = vertices[neighbor_id].edges;
-		auto findResult = neighbor_edges.find(u);
-		assert(findResult != neighbor_edges.end());
-		int edgeWeight = findResult->second;
-		neighbor_edges.erase(findResult); // 2.1 - erase the edge connecting the current neighbor to <u>
-
-		// 2.2 - Create the edge incident on <u> and <v'>
-		findResult = v_edges.find(neighbor_id); 
-		if (findResult != v_edges.end()) {
-			findResult->second += edgeWeight;
-			vertices[neighbor_id].edges[v] += edgeWeight;
-		}
-		else {
-			vertices[it->first].edges.insert({ v, edgeWeight });
-			vertices[v].edges.insert({ it->first, edgeWeight });
-		}
+	// 3 - The edges of <u> are needed only if <v> will aggregate its members later
+	if (v_community.processed) {
+		vector<Edge>().swap(aggregated[u]);
 	}
-
-	// 3 - Build the self-loop on <v'>
-	unordered_map<uint, uint>::iterator v_u_edge = v_edges.find(u), v_v_edge = v_edges.find(v), u_u_edge = u_edges.find(u);
-	assert(v_u_edge != v_edges.end());
-	int loopWeight = 2 * (v_u_edge->second);
-	loopWeight += (v_v_edge == v_edges.end() ? 0 : v_v_edge->second);
-	loopWeight += (u_u_edge == u_edges.end() ? 0 : u_u_edge->second);
-	v_edges.insert({ v, loopWeight });
-
-	// 4 - vertex <u> no more exists, clear it
-	u_edges.clear();
-	v_edges.erase(v_u_edge);
-	vertices[u].merged = true;
 }
 
 void Ordering::community_detection() {
-	// Sort the array of vertices with respect to increasing order of degree
-	vector<Vertex> sortedVertices = vertices;
-	sort(sortedVertices.begin(), sortedVertices.end()); // keeps the vertices sorted in increasing order of degree
-
-	vector<Vertex> originalArray = vertices; // we'll modify the <vertices> array by performing merge operations,
-	// we'll use <originalArray> to revert back to the original array we had
-	
-	// 2 - Iterate vertices in increasing order of degree
-	for (vector<Vertex>::const_iterator iter = sortedVertices.begin(); iter != sortedVertices.end(); iter++) {
-		Vertex & currentVertex = vertices[iter->label];
-		if (currentVertex.edges.empty() || currentVertex.merged) { // no merging operations will be performed if degree is 0
-			continue;
-		}
+	// 1 - Initialize the merge state, every vertex is a community by itself
+	vector<Community>(num_vertices).swap(communities);
+	total_strength = 0.0;
+	for (uint u = 0; u < num_vertices; u++) {
+		communities[u].dest.store(u, memory_order_relaxed);
+		communities[u].child.store(NONE, memory_order_relaxed);
+		communities[u].sibling = NONE;
+		communities[u].node = u;
+		communities[u].processed = false;
+		communities[u].saved = false;
+
+		communities[u].strength.store(graph.weighted_degree(u), memory_order_relaxed);
+		total_strength += graph.weighted_degree(u);
+	}
+	aggregated.assign(num_vertices, vector<Edge>());
 
-		std::pair<uint, double> maxModularityNeighbor = { INT_MIN, INT_MIN }; // < vertex_label, modularity >
-		auto & edges = currentVertex.edges;
-		for (auto edge = edges.begin(); edge != edges.end(); edge++) {
-			int neighborLabel = edge->first;
-			if (vertices[neighborLabel].label == currentVertex.label) {
-				continue;
-			}
+	// 2 - Order the vertices by increasing degree [counting sort over the degrees]
+	uint max_degree = 0;
+	for (uint u = 0; u < num_vertices; u++) {
+		max_degree = max(max_degree, graph.degree(u));
+	}
+	vector<uint> degree_offsets(static_cast<size_t>(max_degree) + 2, 0);
+	for (uint u = 0; u < num_vertices; u++) {
+		degree_offsets[graph.degree(u) + 1]++;
+	}
+	for (uint degree = 0; degree <= max_degree; degree++) {
+		degree_offsets[degree + 1] += degree_offsets[degree];
+	}
+	vector<uint> order(num_vertices);
+	for (uint u = 0; u < num_vertices; u++) {
+		order[degree_offsets[graph.degree(u)]++] = u;
+	}
 
-			double currentModularity = modularity(neighborLabel, iter->label);
-			if (currentModularity > maxModularityNeighbor.second) {
-				maxModularityNeighbor = { neighborLabel, currentModularity };
+	// 3 - Threads take vertices in increasing order of degree in small batches,
+	// merges that conflict with another thread are retried once all vertices are processed
+	const uint batch_size = 64;
+	atomic<uint> next_vertex(0);
+	vector< vector<uint> > retries(num_threads);
+	common::run_threads(num_threads, [&](uint thread_id) {
+		vector<Edge> edges;
+		for (uint begin = next_vertex.fetch_add(batch_size); begin < num_vertices; begin = next_vertex.fetch_add(batch_size)) {
+			const uint end = min(begin + batch_size, num_vertices);
+			for (uint i = begin; i < end; i++) {
+				const uint u = order[i];
+				if (graph.degree(u) == 0) { // no merging operations will be performed if degree is 0
+					continue;
+				}
+				if (!processVertex(u, edges)) {
+					retries[thread_id].push_back(u);
+				}
 			}
 		}
-		if (maxModularityNeighbor.second > 0) {
-			int previousLabel = vertices[maxModularityNeighbor.first].label;
-			mergeVertices(iter->label, maxModularityNeighbor.first);
-			dendrogram.connect(currentVertex.label, previousLabel);
+	});
+
+	// 4 - Retried vertices are processed by a single thread so they can't conflict again
+	vector<Edge> edges;
+	for (uint thread_id = 0; thread_id < num_threads; thread_id++) {
+		for (vector<uint>::const_iterator u = retries[thread_id].begin(); u != retries[thread_id].end(); u++) {
+			processVertex(*u, edges);
 		}
 	}
-
-	// We've modified the <vertices> array, revert it back to it's original state
-	vertices = originalArray;
+	vector< vector<Edge> >().swap(aggregated);
 }
 
-const vector<uint> * Ordering::ordering_generation() {
-	return dendrogram.DFS();
+vector<uint> * Ordering::ordering_generation() {
+	return dendrogram.DFS(num_threads);
 }
 
-double Ordering::modularity(uint u, uint v) {
-	auto edge = vertices[u].edges.find(v);
-	assert(edge != vertices[u].edges.end());
+uint Ordering::findRoot(uint u) {
+	// Follows the merges of <u>, halving the path on the way
+	// [concurrent halving is benign, <dest> only ever moves towards the root]
+	uint dest = communities[u].dest.load(memory_order_acquire);
+	while (dest != u) {
+		const uint next = communities[dest].dest.load(memory_order_acquire);
+		if (next != dest) {
+			communities[u].dest.compare_exchange_weak(dest, next, memory_order_release, memory_order_relaxed);
+		}
+		u = next;
+		dest = communities[u].dest.load(memory_order_acquire);
+	}
+	return u;
+}
 
-	double m = num_edges;
-	double weighted_degree_u = 0.0;
-	double weighted_degree_v = 0.0;
+void Ordering::aggregate(uint u, vector<Edge> & edges) {
+	// Collects the edges of community <u> into <edges>, neighbors are replaced by their communities,
+	// edges internal to the community are dropped and parallel edges are combined
+	edges.clear();
+
+	// 1 - The edges of <u> itself come from the adjacency, or from the previous attempt if it conflicted
+	// [they include the members merged before it, their communities may have changed since]
+	if (communities[u].saved) {
+		for (vector<Edge>::const_iterator edge = aggregated[u].begin(); edge != aggregated[u].end(); edge++) {
+			const uint root = findRoot(edge->toVertex);
+			if (root != u) {
+				edges.push_back({ root, edge->weight });
+			}
+		}
+		vector<Edge>().swap(aggregated[u]);
+		communities[u].saved = false;
+	}
+	else {
+		const uint * neighbors = graph.neighbors(u);
+		const uint * weights = graph.weights(u);
+		for (uint i = 0; i < graph.degree(u); i++) {
+			const uint root = findRoot(neighbors[i]);
+			if (root != u) {
+				edges.push_back({ root, weights[i] });
+			}
+		}
+	}
 
-	for (unordered_map<uint, uint>::iterator u_edge = vertices[u].edges.begin(); u_edge != vertices[u].edges.end(); u_edge++) {
-		weighted_degree_u += u_edge->second;
+	// 2 - Merged vertices have aggregated their own members when they were processed
+	for (uint child = communities[u].child.load(memory_order_acquire); child != NONE; child = communities[child].sibling) {
+		for (vector<Edge>::const_iterator edge = aggregated[child].begin(); edge != aggregated[child].end(); edge++) {
+			const uint root = findRoot(edge->toVertex);
+			if (root != u) {
+				edges.push_back({ root, edge->weight });
+			}
+		}
+		vector<Edge>().swap(aggregated[child]);
 	}
-	for (unordered_map<uint, uint>::iterator v_edge = vertices[v].edges.begin(); v_edge != vertices[v].edges.end(); v_edge++) {
-		weighted_degree_v += v_edge->second;
+
+	// 3 - Combine the edges to the same community
+	sort(edges.begin(), edges.end(), [](const Edge & lhs, const Edge & rhs) {
+		return lhs.toVertex < rhs.toVertex;
+	});
+	size_t unique_count = 0;
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (unique_count > 0 && edges[unique_count - 1].toVertex == edges[i].toVertex) {
+			edges[unique_count - 1].weight += edges[i].weight;
+		}
+		else {
+			edges[unique_count++] = edges[i];
+		}
 	}
+	edges.resize(unique_count);
+}
 
-	double modularity = ((static_cast<double>(edge->second) / (2.0 * m)) - (weighted_degree_u * weighted_degree_v / ((2.0 * m) * (2.0 * m))));
+double Ordering::modularity(uint64_t u_strength, uint64_t v_strength, uint weight) const {
+	// Modularity gain of merging two communities connected with an edge of <weight>
+	const double two_m = total_strength;
+	double modularity = (static_cast<double>(weight) / two_m) - (static_cast<double>(u_strength) * v_strength / (two_m * two_m));
 	return modularity;
 }
 }
@@ -1,11 +1,15 @@
 #ifndef _ORDERING_H
+#define _ORDERING_H
 
 #include <list>
 #include <vector>
+#include <string>
 #include <exception>
-#include <unordered_map>
-#include <set>
+#include <climits>
+#include <cstdint>
+#include <atomic>
 #include "dendrogram.hpp"
+#include "../Graph/csr_graph.hpp"
 
 namespace rabbit
 {
@@ -15,60 +19,55 @@ typedef unsigned int uint;
 struct Edge {
 	uint toVertex;
 	uint weight;
-
-	bool operator=(const uint rhs) {
-		return this->toVertex == rhs;
-	}
 };
 
 class Ordering {
 public:
 	Ordering(std::string filename, bool symmetric = true,
-		bool zeroBased = true, bool writeGraph = false); // Reads adjacency list graph with header info
+		bool zeroBased = true, bool writeGraph = false, uint num_threads = 0); // Reads adjacency list graph with header info
+	explicit Ordering(graph::CSRGraph graph, uint num_threads = 0); // Graph already in memory [e.g. built by convert]
 
-	void insertEdge(uint from, uint to, uint value);
 	void rabbitOrder(const std::string output_filename);
+	const std::vector<uint> & computePermutation(); // new label of every vertex, also used by rabbitOrder
 private:
-	struct EdgeComparator {
-		bool operator()(const Edge & lhs, const Edge & rhs) const {
-			return lhs.toVertex == rhs.toVertex;
-		}
-		bool operator()(const Edge & lhs, const uint & rhs) const {
-			return lhs.toVertex == rhs;
-		}
+	// Merge state of a vertex, kept apart from the adjacency which is never modified.
+	// Vertices merged into a community form a tree through <child> & <sibling>.
+	// <strength> is the weighted degree of the community, a thread owns the community while
+	// it holds INVALID_STRENGTH; merging into a community owned by another thread fails and is retried later
+	struct Community {
+		std::atomic<uint> dest; // community the vertex has been merged into, itself for community roots
+		std::atomic<uint> child; // last vertex merged into this one [NONE if nothing was merged]
+		uint sibling; // vertex merged into <dest> before this one
+		uint node; // dendrogram node representing the community
+		std::atomic<uint64_t> strength; // stays INVALID_STRENGTH once the vertex is merged
+		bool processed; // the community has aggregated its members, merging into it no longer needs their edges
+		bool saved; // aggregated[vertex] holds the edges of the community from an attempt that conflicted
 	};
 
-	struct Vertex {
-		Vertex() : label(labelCounter++), merged(false) { }
-		
-		std::unordered_map<uint, uint> edges; // < neighbor label, edge weight >
-		static uint labelCounter; // will be used to give out labels
-		bool merged;
-		uint label;
-
-		bool operator < (const Vertex & rhs) const {
-			return this->edges.size() < rhs.edges.size();
-		}
-	};
+	static const uint64_t INVALID_STRENGTH = UINT64_MAX;
+	static const uint NONE = UINT_MAX;
 
 	// Member variables
-	uint new_id;
-	uint num_edges;
 	uint num_vertices;
-	std::vector<uint> dimension_widths;
+	double total_strength; // 2m, twice the total edge weight
 	bool symmetric;
-	bool valuesExist;
 	bool writeGraph;
-	std::vector<Vertex> vertices;
+	graph::CSRGraph graph;
+	std::vector<Community> communities;
+	std::vector< std::vector<Edge> > aggregated; // edges of merged vertices whose community hasn't been processed yet
 	std::vector<uint> new_labels;
 	Dendrogram dendrogram;
+	uint num_threads;
 
 	// Sub-Algorithms
+	bool processVertex(uint u, std::vector<Edge> & edges); // false if the merge conflicted and has to be retried
 	void mergeVertices(uint u, uint v);
-	const std::vector<uint> * ordering_generation();
+	std::vector<uint> * ordering_generation(); // allocated by the dendrogram, owned by the caller
 
 	// Utilities
-	double modularity(uint u, uint v);
+	uint findRoot(uint u);
+	void aggregate(uint u, std::vector<Edge> & edges);
+	double modularity(uint64_t u_strength, uint64_t v_strength, uint weight) const;
 	void community_detection();
 };
 
@@ -114,7 +113,7 @@ public:
 
 class InputFileErrorException : public GraphException {
 public:
-	InputFileErrorException(char * m = "Cannot read the input file")
+	InputFileErrorException(const char * m = "Cannot read the input file")
 		: GraphException() {
 		msg = m;
 	}
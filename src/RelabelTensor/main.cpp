@@ -1,5 +1,6 @@
 #include <iostream>
 #include "relabel.hpp"
+#include "../Tensor/tensor.hpp"
 #include <vector>
 using namespace std;
 
@@ -16,7 +17,8 @@ void help() {
 	usage();
 	cout << "Available options" << endl
 		<< "\t-o FILENAME\t\t sets the name of the output file" << endl
-		<< "\t-v \t\t verbose mode" << endl;
+		<< "\t-v \t\t verbose mode" << endl
+		<< "\t-threads N\t\t number of threads relabeling each window of the tensor" << endl;
 }
 
 int relabelMain(int argc, char * argv[]) {
@@ -41,6 +43,7 @@ int relabelMain(int argc, char * argv[]) {
 	}
 
 	bool verbose = false;
+	uint num_threads = 0;
 	string tensor_file;
 	string permutation_file;
 	string output_file = "relabeled_tensor.tns";
@@ -73,6 +76,14 @@ int relabelMain(int argc, char * argv[]) {
 			i++;
 			output_file = arguments[i];
 		}
+		else if (arguments[i] == "-threads") { // thread count
+			if (i + 1 >= argc || arguments[i + 1][0] == '-') {
+				cerr << "expected number of threads, didn't find one!" << endl;
+				exit(1);
+			}
+			i++;
+			num_threads = atoi(arguments[i].c_str());
+		}
 		else { // unknown argument!
 			cerr << "Unknown argument encountered: " << arguments[i] << endl;
 			exit(1);
@@ -88,8 +99,14 @@ int relabelMain(int argc, char * argv[]) {
 		exit(1);
 	}
 
-	Relabel relabel_obj(permutation_file, verbose);
-	relabel_obj.relabel_tensor(tensor_file, output_file);
+	Relabel relabel_obj(permutation_file, verbose, num_threads);
+	try {
+		relabel_obj.relabel_tensor(tensor_file, output_file);
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot read the tensor file " << tensor_file << ": " << exc.what() << endl;
+		exit(1);
+	}
 
 	return 0;
 }
@@ -1,20 +1,38 @@
 #include "relabel.hpp"
+#include "../Tensor/tensor.hpp"
+#include "../Common/parallel.hpp"
+#include "../Common/text_parse.hpp"
 #include <fstream>
 #include <string>
 #include <chrono>
 #include <iostream>
 #include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <climits>
 
 using namespace std;
 namespace relabel
 {
-Relabel::Relabel(const string perm_file, bool verbose) : verbose(verbose) {
-	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
-	cout << "Start: reading permutation file" << endl;
+namespace
+{
+// Bytes of text handled by one thread per window, the window is the only buffer that grows with the thread count
+const size_t WINDOW_BYTES_PER_THREAD = 4 << 20;
+// Nonzeros of a binary tensor formatted by one thread per round
+const uint64_t BINARY_BLOCK = 1 << 18;
+// Text nonzeros parsed before their coordinates are relabeled together
+const uint LINE_BLOCK = 1024;
+const uint NONE = UINT_MAX;
+}
+
+void read_permutation_file(const string & perm_file, vector<uint> & dimension_widths, vector<uint> & permutation_labels, bool verbose) {
 	// 1 - Create the read stream
 	ifstream perm_is(perm_file);
 	if (!perm_is.is_open()) {
 		cerr << "Cannot open the permutation file " << perm_file << endl;
+		exit(1);
 	}
 	if (verbose) {
 		cout << endl << "Permutation file was successfuly opened\n";
@@ -24,11 +42,13 @@ Relabel::Relabel(const string perm_file, bool verbose) : verbose(verbose) {
 	// 2.1 - read header info [dimension widths and # of labels]
 	string line_buffer;
 	getline(perm_is, line_buffer);
-	if (line_buffer[0] != '%') {
+	if (line_buffer.empty() || line_buffer[0] != '%') {
 		cerr << "permutation file is incompatible - header info missing" << endl;
+		exit(1);
 	}
 	istringstream iss(line_buffer);
 	iss >> line_buffer;
+	dimension_widths.clear();
 	while (!iss.eof()) {
 		string current_width;
 		iss >> current_width;
@@ -45,13 +65,46 @@ Relabel::Relabel(const string perm_file, bool verbose) : verbose(verbose) {
 	iss >> line_buffer;
 	if (line_buffer != "%") {
 		cerr << "permutation file is incompatible - header info missing" << endl;
+		exit(1);
 	}
 	uint num_vertices;
 	iss >> num_vertices;
 	permutation_labels.resize(num_vertices);
 	if (verbose) {
-		cout << "header file was successfully read from permutation file\n" << endl;
+		cout << "header file was successfully read from permutation file\n" << endl
+			<< "reading new labels from permutation file" << endl << endl;
+	}
+
+	for (int i = 0; i < num_vertices; i++) {
+		uint label_i;
+		perm_is >> label_i;
+		permutation_labels[i] = label_i;
 	}
+}
+
+bool write_permutation_file(const string & perm_file, const vector<uint> & dimension_widths, const vector<uint> & permutation_labels) {
+	ofstream os(perm_file);
+	if (!os.is_open()) {
+		return false;
+	}
+	os << "% ";
+	for (uint i = 0; i < dimension_widths.size(); i++) {
+		os << dimension_widths[i] << " ";
+	}
+	os << '\n' << "% " << permutation_labels.size() << '\n';
+	for (vector<uint>::const_iterator it = permutation_labels.begin(); it != permutation_labels.end(); it++) {
+		os << *it << " ";
+	}
+	return static_cast<bool>(os);
+}
+
+// Class Relabel
+
+Relabel::Relabel(const string perm_file, bool verbose, uint num_threads)
+	: verbose(verbose), num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	cout << "Start: reading permutation file" << endl;
+	read_permutation_file(perm_file, dimension_widths, permutation_labels, verbose);
 
 	cout << "Tensor dimensions: ";
 	for (int i = 0; i < dimension_widths.size(); i++) {
@@ -62,71 +115,304 @@ Relabel::Relabel(const string perm_file, bool verbose) : verbose(verbose) {
 	}
 	cout << endl;
 
-	if (verbose) {
-		cout << "reading new labels from permutation file" << endl << endl;
-	}
-	for (int i = 0; i < num_vertices; i++) {
-		uint label_i;
-		perm_is >> label_i;
-		permutation_labels[i] = label_i;
-	}
+	build_mode_tables();
 	end = chrono::high_resolution_clock::now();
 	cout << "End: reading permutation file [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
 }
 
+Relabel::Relabel(const vector<uint> & permutation_labels, const vector<uint> & dimension_widths, bool verbose, uint num_threads)
+	: permutation_labels(permutation_labels), dimension_widths(dimension_widths), verbose(verbose),
+	num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
+	build_mode_tables();
+}
+
 void Relabel::relabel_tensor(const string tensor_file, const string output_file) {
-	ifstream tns_is(tensor_file);
-	if (!tns_is.is_open()) {
-		cerr << "Cannot open the tensor file " << tensor_file << endl;
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	ifstream is(tensor_file, ios::binary);
+	if (!is.is_open()) {
+		throw tensor::TensorException("Cannot open the tensor file");
 	}
-	if (verbose) {
-		cout << endl << "Successfully opened tensor file" << endl;
+	ofstream os(output_file, ios::binary);
+	if (!os.is_open()) {
+		cerr << "Cannot create the output file " << output_file << endl;
+		exit(1);
 	}
-	ofstream os(output_file);
 
-	// skip the header info of the tensor file if it exists
-	streampos prev_position = tns_is.tellg();
-	string line_buffer;
-	uint num_header_lines = 0;
-	getline(tns_is, line_buffer);
-	while (line_buffer[0] == '%') {
-		prev_position = tns_is.tellg();
-		num_header_lines++;
-		getline(tns_is, line_buffer);
-	}
-	tns_is.seekg(prev_position);
+	// binary containers are mapped, text files are read window by window
+	char magic[sizeof(tensor::BINARY_MAGIC)] = { 0 };
+	is.read(magic, sizeof(magic));
+	const bool binary = is.gcount() == sizeof(magic) && memcmp(magic, tensor::BINARY_MAGIC, sizeof(magic)) == 0;
+	is.clear();
+	is.seekg(0);
+	uint64_t nonzeros;
+	if (binary) {
+		is.close();
+		nonzeros = relabel_coo(tensor::CooTensor(tensor_file), os);
+	}
+	else {
+		nonzeros = relabel_text(is, os);
+	}
+	if (!os) {
+		cerr << "Cannot write the output file " << output_file << endl;
+		exit(1);
+	}
+	end = chrono::high_resolution_clock::now();
 	if (verbose) {
-		cout << "read " << num_header_lines << " line(s) of header info in tensor file\n\n";
+		cout << "Relabeled " << nonzeros << " nonzeros" << endl;
 	}
+	cout << "End: create relabeled tensor file [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]\n";
+}
 
+void Relabel::relabel_tensor(const tensor::CooTensor & coo, const string output_file) {
 	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
-	const uint dimension = dimension_widths.size();
-	while (!tns_is.eof()) {
-		uint current_coordinate, value;
-		for (int i = 0; i < dimension; i++) {
-			tns_is >> current_coordinate;
-			os << getTensorCoordinate(current_coordinate) << ' ';
-		}
-		tns_is >> value;
-		os << value << endl;
+	ofstream os(output_file, ios::binary);
+	if (!os.is_open()) {
+		cerr << "Cannot create the output file " << output_file << endl;
+		exit(1);
+	}
+	relabel_coo(coo, os);
+	if (!os) {
+		cerr << "Cannot write the output file " << output_file << endl;
+		exit(1);
 	}
 	end = chrono::high_resolution_clock::now();
 	cout << "End: create relabeled tensor file [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]\n";
 }
 
-uint Relabel::getTensorCoordinate(const uint & label) const {
-	if (label < dimension_widths[0]) {
-		return label;
+// Class Relabel | Private Member Function Definitions
+
+void Relabel::build_mode_tables() {
+	const uint dimension = dimension_widths.size();
+	vector<uint> offsets(dimension + 1, 0);
+	for (uint mode = 0; mode < dimension; mode++) {
+		offsets[mode + 1] = offsets[mode] + dimension_widths[mode];
+	}
+	if (offsets[dimension] != permutation_labels.size()) {
+		cerr << "permutation file is incompatible - number of labels doesn't match the dimension widths" << endl;
+		exit(1);
+	}
+
+	// vertices in the order of their new labels
+	const uint num_vertices = permutation_labels.size();
+	vector<uint> order(num_vertices, NONE);
+	for (uint vertex = 0; vertex < num_vertices; vertex++) {
+		const uint label = permutation_labels[vertex];
+		if (label >= num_vertices || order[label] != NONE) {
+			cerr << "permutation file is incompatible - labels are not a permutation" << endl;
+			exit(1);
+		}
+		order[label] = vertex;
 	}
-	
-	uint offset = dimension_widths[0];
-	for (int i = 1; i < dimension_widths.size(); i++) {
-		if (label < dimension_widths[i]) {
-			return offset + label;
+
+	// walking the labels in increasing order hands out the new coordinates of every mode
+	mode_tables.resize(dimension);
+	for (uint mode = 0; mode < dimension; mode++) {
+		mode_tables[mode].resize(dimension_widths[mode]);
+	}
+	vector<uint> next_coordinate(dimension, 0);
+	for (uint label = 0; label < num_vertices; label++) {
+		const uint vertex = order[label];
+		const uint mode = upper_bound(offsets.begin() + 1, offsets.end(), vertex) - (offsets.begin() + 1);
+		mode_tables[mode][vertex - offsets[mode]] = next_coordinate[mode]++;
+	}
+}
+
+void Relabel::relabel_block(uint mode, const uint * coordinates, uint * relabeled, uint count) const {
+	// a branch free gather, coordinates are checked against the widths before they get here
+	const uint * table = mode_tables[mode].data();
+	for (uint i = 0; i < count; i++) {
+		relabeled[i] = table[coordinates[i]];
+	}
+}
+
+uint64_t Relabel::relabel_text(ifstream & is, ofstream & os) const {
+	const uint dimension = dimension_widths.size();
+	vector<char> window(WINDOW_BYTES_PER_THREAD * num_threads);
+	vector<string> buffers(num_threads);
+	vector<uint64_t> records(num_threads, 0);
+	atomic<bool> malformed(false);
+	bool checked_dimension = false;
+	size_t carry = 0; // bytes of an incomplete line moved to the front of the window
+
+	while (true) {
+		is.read(window.data() + carry, window.size() - carry);
+		const bool last = is.eof();
+		const char * data = window.data(), * data_end = data + carry + is.gcount();
+
+		// only complete lines are processed, the rest waits for the next window
+		const char * lines_end = data_end;
+		if (!last) {
+			while (lines_end != data && lines_end[-1] != '\n') {
+				lines_end--;
+			}
+			if (lines_end == data) { // a line longer than the window
+				carry = window.size();
+				window.resize(window.size() * 2);
+				continue;
+			}
+		}
+
+		// 1 - The first record [coordinates & value] decides whether the tensor matches the permutation
+		if (!checked_dimension) {
+			const char * line = data;
+			while (line != lines_end && !common::is_record(line, lines_end)) {
+				line = common::next_line(line, lines_end);
+			}
+			if (line != lines_end) {
+				uint num_tokens = 0;
+				for (const char * token = common::skip_blanks(line, lines_end); token != lines_end && *token != '\n'; token = common::skip_blanks(token, lines_end)) {
+					num_tokens++;
+					while (token != lines_end && !common::is_blank(*token) && *token != '\n') {
+						token++;
+					}
+				}
+				if (num_tokens != dimension + 1) {
+					cerr << "Tensor dimension doesn't match the dimension in the permutation file" << endl;
+					exit(1);
+				}
+				checked_dimension = true;
+			}
+		}
+
+		// 2 - Newline aligned chunks are relabeled in parallel, every thread formats into its own buffer
+		const size_t length = lines_end - data;
+		vector<const char *> chunk_begin(num_threads + 1);
+		chunk_begin[0] = data;
+		chunk_begin[num_threads] = lines_end;
+		for (uint i = 1; i < num_threads; i++) {
+			const char * boundary = data + length * i / num_threads;
+			if (boundary != data && boundary[-1] != '\n') {
+				boundary = common::next_line(boundary, lines_end);
+			}
+			chunk_begin[i] = max(boundary, chunk_begin[i - 1]);
 		}
-		else {
-			offset += dimension_widths[i];
+		common::run_threads(num_threads, [&](uint chunk) {
+			string & buffer = buffers[chunk];
+			buffer.clear();
+			buffer.reserve(chunk_begin[chunk + 1] - chunk_begin[chunk] + (chunk_begin[chunk + 1] - chunk_begin[chunk]) / 4 + 64);
+			char number[24];
+
+			// LINE_BLOCK records are parsed into mode by mode arrays, relabeled together & formatted
+			vector<uint> coordinates(dimension * LINE_BLOCK), relabeled(dimension * LINE_BLOCK);
+			vector<const char *> value_begin(LINE_BLOCK), value_end(LINE_BLOCK);
+			uint count = 0;
+			auto format_block = [&]() {
+				for (uint mode = 0; mode < dimension; mode++) {
+					relabel_block(mode, &coordinates[mode * LINE_BLOCK], &relabeled[mode * LINE_BLOCK], count);
+				}
+				for (uint i = 0; i < count; i++) {
+					for (uint mode = 0; mode < dimension; mode++) {
+						buffer.append(number, common::format_uint(relabeled[mode * LINE_BLOCK + i], number));
+						buffer.push_back(' ');
+					}
+					buffer.append(value_begin[i], value_end[i]);
+					buffer.push_back('\n');
+				}
+				records[chunk] += count;
+				count = 0;
+			};
+
+			for (const char * line = chunk_begin[chunk]; line != chunk_begin[chunk + 1]; line = common::next_line(line, lines_end)) {
+				if (!common::is_record(line, lines_end)) {
+					continue;
+				}
+				const char * token = line;
+				for (uint mode = 0; mode < dimension; mode++) {
+					uint64_t coordinate;
+					if (!common::parse_uint(token, lines_end, coordinate) || coordinate >= dimension_widths[mode]) {
+						malformed = true;
+						return;
+					}
+					coordinates[mode * LINE_BLOCK + count] = static_cast<uint>(coordinate);
+				}
+
+				// the value is copied verbatim, there is nothing to gain from parsing & formatting it again
+				const char * value = common::skip_blanks(token, lines_end), * end = value;
+				while (end != lines_end && *end != '\n') {
+					end++;
+				}
+				while (end != value && common::is_blank(end[-1])) {
+					end--;
+				}
+				if (value == end) {
+					malformed = true;
+					return;
+				}
+				value_begin[count] = value;
+				value_end[count] = end;
+				if (++count == LINE_BLOCK) {
+					format_block();
+				}
+			}
+			format_block();
+		});
+		if (malformed) {
+			throw tensor::TensorException("Tensor file contains a malformed nonzero");
+		}
+		for (uint chunk = 0; chunk < num_threads; chunk++) {
+			os.write(buffers[chunk].data(), buffers[chunk].size());
+		}
+
+		if (last) {
+			break;
+		}
+		carry = data_end - lines_end;
+		memmove(window.data(), lines_end, carry);
+	}
+
+	uint64_t nonzeros = 0;
+	for (uint chunk = 0; chunk < num_threads; chunk++) {
+		nonzeros += records[chunk];
+	}
+	return nonzeros;
+}
+
+uint64_t Relabel::relabel_coo(const tensor::CooTensor & coo, ofstream & os) const {
+	// binary containers are mapped, so rounds of BINARY_BLOCK nonzeros per thread keep the buffers small
+	const uint dimension = dimension_widths.size();
+	if (coo.dimension() != dimension) {
+		cerr << "Tensor dimension doesn't match the dimension in the permutation file" << endl;
+		exit(1);
+	}
+
+	for (uint mode = 0; mode < dimension; mode++) {
+		if (coo.mode_widths()[mode] > dimension_widths[mode]) {
+			cerr << "Tensor coordinates exceed the dimension widths in the permutation file" << endl;
+			exit(1);
+		}
+	}
+
+	vector<string> buffers(num_threads);
+	for (uint64_t round = 0; round < coo.nnz(); round += BINARY_BLOCK * num_threads) {
+		common::run_threads(num_threads, [&](uint thread_id) {
+			const uint64_t first = min(coo.nnz(), round + BINARY_BLOCK * thread_id);
+			const uint count = static_cast<uint>(min(coo.nnz(), first + BINARY_BLOCK) - first);
+			vector<uint> relabeled(static_cast<size_t>(dimension) * count);
+			for (uint mode = 0; mode < dimension; mode++) {
+				relabel_block(mode, coo.coordinates(mode) + first, &relabeled[static_cast<size_t>(mode) * count], count);
+			}
+
+			string & buffer = buffers[thread_id];
+			buffer.clear();
+			char number[32];
+			for (uint i = 0; i < count; i++) {
+				for (uint mode = 0; mode < dimension; mode++) {
+					buffer.append(number, common::format_uint(relabeled[static_cast<size_t>(mode) * count + i], number));
+					buffer.push_back(' ');
+				}
+				if (coo.has_values()) {
+					buffer.append(number, tensor::format_value(coo.values()[first + i], number));
+				}
+				else {
+					buffer.pop_back();
+				}
+				buffer.push_back('\n');
+			}
+		});
+		for (uint thread_id = 0; thread_id < num_threads; thread_id++) {
+			os.write(buffers[thread_id].data(), buffers[thread_id].size());
 		}
 	}
+	return coo.nnz();
 }
 }
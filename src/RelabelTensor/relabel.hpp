@@ -3,23 +3,49 @@
 
 #include <vector>
 #include <string>
+#include <fstream>
+#include "../Tensor/tensor.hpp"
 namespace relabel
 {
 typedef unsigned int uint;
 
+// Reads a permutation file [the format rcm & rabbit write]: the dimension widths of the tensor and the new label
+// of every vertex of its k-partite graph. Exits when the file doesn't have that format
+void read_permutation_file(const std::string & permutation_file, std::vector<uint> & dimension_widths,
+	std::vector<uint> & permutation_labels, bool verbose = false);
+// Writes <permutation_labels> in the format read_permutation_file reads, every ordering writes its permutation
+// through it. Returns false when the file cannot be created or written, the caller reports it its own way
+bool write_permutation_file(const std::string & permutation_file, const std::vector<uint> & dimension_widths,
+	const std::vector<uint> & permutation_labels);
+
 class Relabel {
 public:
-	Relabel(const std::string permutation_file, bool verbose);
+	Relabel(const std::string permutation_file, bool verbose, uint num_threads = 0);
+	// Permutation already in memory, <permutation_labels[v]> is the new label of vertex v of the k-partite graph
+	Relabel(const std::vector<uint> & permutation_labels, const std::vector<uint> & dimension_widths, bool verbose, uint num_threads = 0);
 
+	// Streams the tensor through fixed size windows, every window is relabeled by all threads
+	// into per-thread buffers which are written in order. Value text is copied as it is
 	void relabel_tensor(const std::string tensor_file, const std::string output_file);
+	void relabel_tensor(const tensor::CooTensor & coo, const std::string output_file);
+
+	const std::vector< std::vector<uint> > & relabeling() const { return mode_tables; }
 private:
 	std::vector<uint> tensor_coordiantes;
 	std::vector<uint> permutation_labels;
 	std::vector<uint> dimension_widths;
 
+	// mode_tables[m][c] is the new coordinate of c in mode m: the rank of its new vertex label
+	// among the labels of mode m, so every mode keeps its own index range
+	std::vector< std::vector<uint> > mode_tables;
+
 	bool verbose;
+	uint num_threads;
 
-	uint getTensorCoordinate(const uint & label) const;
+	void build_mode_tables();
+	void relabel_block(uint mode, const uint * coordinates, uint * relabeled, uint count) const;
+	uint64_t relabel_text(std::ifstream & is, std::ofstream & os) const;
+	uint64_t relabel_coo(const tensor::CooTensor & coo, std::ofstream & os) const;
 };
 }
 #endif
@@ -0,0 +1,201 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+#include "../Tensor/tensor.hpp"
+#include "../TensorToGraph/convert.hpp"
+#include "../RabbitOrder/ordering.hpp"
+#include "../RCM/rcm.hpp"
+#include "../HypergraphOrder/hypergraph.hpp"
+#include "../LexiOrder/lexi_order.hpp"
+#include "../RelabelTensor/relabel.hpp"
+using namespace std;
+
+namespace reorder
+{
+void usage() {
+	cout << "Usage: PURE reorder TENSOR [-algo rabbit|rcm|hypergraph|lexi] -[OPTIONS...]" << endl;
+}
+
+void help() {
+	cout << "Tensor reordering pipeline" << endl
+		<< "--------------------------" << endl
+		<< "Converts the tensor into its k-partite graph, orders the graph and relabels the tensor" << endl
+		<< "in a single process, nothing is written between the stages unless it is asked for." << endl
+		<< "The hypergraph & Lexi-Order orderings work on the tensor itself, no graph is built for it" << endl;
+	usage();
+	cout << "Available options" << endl
+		<< "\t-algo NAME\t\t ordering algorithm, rabbit [default], rcm, hypergraph or lexi" << endl
+		<< "\t-o FILENAME\t\t sets the name of the relabeled tensor file" << endl
+		<< "\t-dump_graph FILENAME\t also writes the graph in the format convert writes [rabbit & rcm]" << endl
+		<< "\t-dump_perm FILENAME\t also writes the permutation in the format relabel reads" << endl
+		<< "\t-weight_based \t\t weight based RCM" << endl
+		<< "\t-leaf_size N\t\t hypergraph subproblems up to N vertices keep their order [default: 32]" << endl
+		<< "\t-imbalance X\t\t allowed deviation of a hypergraph part from half of the vertices [default: 0.05]" << endl
+		<< "\t-rounds N\t\t largest number of Lexi-Order rounds [default: 5]" << endl
+		<< "\t-threads N\t\t number of threads used by every stage" << endl
+		<< "\t-v \t\t verbose mode" << endl;
+}
+
+int reorderMain(int argc, char * argv[]) {
+	cout << "************************************" << endl;
+	// 1 - parse the command line options
+	vector<string> arguments(argc);
+	for (int i = 0; i < argc; i++) {
+		arguments[i] = string(argv[i]);
+	}
+
+	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
+		help();
+		exit(0);
+	}
+	else if (argc < 2) {
+		usage();
+		exit(0);
+	}
+
+	bool verbose = false, degree_based = true;
+	uint num_threads = 0, leaf_size = 32, rounds = 5;
+	double imbalance = 0.05;
+	string tensor_file, algorithm = "rabbit", output_file = "reordered_tensor.tns", graph_dump, permutation_dump;
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = i + 1 < argc && arguments[i + 1][0] != '-';
+		if (arguments[i] == "-v") {
+			verbose = true;
+		}
+		else if (arguments[i] == "-weight_based") {
+			degree_based = false;
+		}
+		else if (arguments[i] == "-algo" || arguments[i] == "-o" || arguments[i] == "-dump_graph"
+			|| arguments[i] == "-dump_perm" || arguments[i] == "-threads" || arguments[i] == "-leaf_size"
+			|| arguments[i] == "-imbalance" || arguments[i] == "-rounds") {
+			if (!has_value) {
+				cerr << "expected a value after " << arguments[i] << ", didn't find one!" << endl;
+				exit(1);
+			}
+			const string & value = arguments[++i];
+			if (arguments[i - 1] == "-algo") {
+				algorithm = value;
+			}
+			else if (arguments[i - 1] == "-o") {
+				output_file = value;
+			}
+			else if (arguments[i - 1] == "-dump_graph") {
+				graph_dump = value;
+			}
+			else if (arguments[i - 1] == "-dump_perm") {
+				permutation_dump = value;
+			}
+			else if (arguments[i - 1] == "-leaf_size") {
+				leaf_size = atoi(value.c_str());
+			}
+			else if (arguments[i - 1] == "-imbalance") {
+				imbalance = atof(value.c_str());
+			}
+			else if (arguments[i - 1] == "-rounds") {
+				rounds = atoi(value.c_str());
+			}
+			else {
+				num_threads = atoi(value.c_str());
+			}
+		}
+		else if (arguments[i][0] != '-' && tensor_file == "") {
+			tensor_file = arguments[i];
+		}
+		else { // unknown argument!
+			cerr << "Unknown argument encountered: " << arguments[i] << endl;
+			exit(1);
+		}
+	}
+
+	if (tensor_file == "") {
+		cerr << "A tensor file must be provided!" << endl;
+		exit(1);
+	}
+	if (algorithm != "rabbit" && algorithm != "rcm" && algorithm != "hypergraph" && algorithm != "lexi") {
+		cerr << "Unknown ordering algorithm " << algorithm << ", expected rabbit, rcm, hypergraph or lexi" << endl;
+		exit(1);
+	}
+	if (imbalance < 0) {
+		cerr << "The imbalance can't be negative" << endl;
+		exit(1);
+	}
+
+	// 2 - every stage hands its result to the next one in memory
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+	try {
+		tensor::CooTensor coo(tensor_file, true, num_threads);
+		vector<uint> widths = coo.mode_widths();
+		cout << "Read " << coo.nnz() << " nonzeros from the tensor file" << endl;
+
+		// 2.1 - permutation, the graph orderings first build the k-partite graph
+		// [the pair arrays of convert are released once the graph is built]
+		vector<uint> permutation;
+		if (algorithm == "hypergraph") {
+			hypergraph::HypergraphOrder ordering(coo, num_threads, leaf_size, imbalance, verbose);
+			permutation = ordering.computePermutation();
+		}
+		else if (algorithm == "lexi") {
+			lexi::LexiOrder ordering(coo, rounds, num_threads, verbose);
+			permutation = ordering.computePermutation();
+		}
+		else {
+			graph::CSRGraph graph;
+			{
+				convert::Convert conv_obj(coo, widths.data(), verbose, num_threads);
+				if (graph_dump != "") {
+					conv_obj.write_graph(graph_dump);
+				}
+				graph = conv_obj.release_graph();
+			}
+			if (algorithm == "rabbit") {
+				rabbit::Ordering ordering(std::move(graph), num_threads);
+				permutation = ordering.computePermutation();
+			}
+			else {
+				rcm::RCM rcm_obj(std::move(graph), degree_based, num_threads);
+				rcm_obj.relabel();
+				permutation = rcm_obj.permutation();
+			}
+		}
+		if (permutation_dump != "") {
+			if (!relabel::write_permutation_file(permutation_dump, widths, permutation)) {
+				cerr << "Cannot write the permutation file " << permutation_dump << endl;
+				exit(1);
+			}
+		}
+
+		// 2.2 - relabeled tensor
+		relabel::Relabel relabel_obj(permutation, widths, verbose, num_threads);
+		relabel_obj.relabel_tensor(coo, output_file);
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot read the tensor file " << tensor_file << ": " << exc.what() << endl;
+		exit(1);
+	}
+	catch (convert::ConvertException & exc) {
+		cerr << "Cannot build the graph of the tensor: " << exc.what() << endl;
+		exit(1);
+	}
+	catch (graph::GraphFileException & exc) {
+		cerr << "Cannot build the graph of the tensor: " << exc.what() << endl;
+		exit(1);
+	}
+	catch (hypergraph::HypergraphException & exc) {
+		cerr << "Cannot order the tensor: " << exc.what() << endl;
+		exit(1);
+	}
+	catch (lexi::LexiException & exc) {
+		cerr << "Cannot order the tensor: " << exc.what() << endl;
+		exit(1);
+	}
+	end = chrono::high_resolution_clock::now();
+	cout << "Reordered tensor has been written to " << output_file << " ["
+		<< chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+	cout << "************************************" << endl;
+	return 0;
+}
+}
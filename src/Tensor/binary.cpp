@@ -0,0 +1,106 @@
+#include "tensor.hpp"
+#include "../Common/mapped_file.hpp"
+#include "../Common/binary_file.hpp"
+#include "../Common/parallel.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+namespace tensor
+{
+using common::aligned;
+using common::write_padded;
+
+// Class CooTensor | Binary container
+
+void CooTensor::map_binary(const shared_ptr<common::MappedFile> & file, uint num_threads) {
+	// 1 - Validate the header
+	if (file->size() < sizeof(BinaryHeader)) {
+		throw TensorException("Binary tensor file is truncated");
+	}
+	BinaryHeader header;
+	memcpy(&header, file->data(), sizeof(header));
+	if (header.version != BINARY_VERSION) {
+		throw TensorException("Unsupported binary tensor version");
+	}
+	if (header.dimension == 0) {
+		throw TensorException("Tensor file has no coordinates");
+	}
+
+	// the counts are bounded by the file size before any size is computed from them, so nothing overflows
+	const uint64_t widths_offset = aligned(sizeof(BinaryHeader));
+	const uint64_t nonzero_size = header.dimension * sizeof(uint) + ((header.flags & BINARY_HAS_VALUES) != 0 ? sizeof(double) : 0);
+	if (file->size() < widths_offset + aligned(header.dimension * sizeof(uint))
+		|| header.nnz > (file->size() - widths_offset - aligned(header.dimension * sizeof(uint))) / nonzero_size) {
+		throw TensorException("Binary tensor file is truncated");
+	}
+
+	num_modes = header.dimension;
+	num_nonzeros = header.nnz;
+	values_exist = (header.flags & BINARY_HAS_VALUES) != 0;
+	coordinate_stride = aligned(num_nonzeros * sizeof(uint)) / sizeof(uint);
+
+	const uint64_t coordinates_offset = widths_offset + aligned(num_modes * sizeof(uint));
+	const uint64_t values_offset = coordinates_offset + num_modes * coordinate_stride * sizeof(uint);
+	const uint64_t expected_size = values_offset + (values_exist ? num_nonzeros * sizeof(double) : 0);
+	if (file->size() < expected_size) {
+		throw TensorException("Binary tensor file is truncated");
+	}
+
+	// 2 - Point into the mapping, only the mode widths are copied
+	const uint * mapped_widths = reinterpret_cast<const uint *>(file->data() + widths_offset);
+	widths.assign(mapped_widths, mapped_widths + num_modes);
+	mapped_coordinates = reinterpret_cast<const uint *>(file->data() + coordinates_offset);
+	mapped_values = values_exist ? reinterpret_cast<const double *>(file->data() + values_offset) : nullptr;
+
+	// 3 - The widths size the tables indexed by the coordinates [relabel, metrics], so every coordinate
+	// must be below the width of its mode. One parallel pass over the coordinates, like the text reader's
+	num_threads = num_threads == 0 ? common::default_thread_count() : num_threads;
+	vector<char> exceeds(num_threads, 0);
+	common::parallel_blocks(num_nonzeros, num_threads, [&](uint64_t begin, uint64_t end, uint thread_id) {
+		for (uint mode = 0; mode < num_modes && begin != end; mode++) {
+			const uint * mode_coordinates = mapped_coordinates + mode * coordinate_stride;
+			uint max_coordinate = 0;
+			for (uint64_t i = begin; i < end; i++) {
+				max_coordinate = max(max_coordinate, mode_coordinates[i]);
+			}
+			exceeds[thread_id] |= max_coordinate >= widths[mode];
+		}
+	});
+	if (find(exceeds.begin(), exceeds.end(), 1) != exceeds.end()) {
+		throw TensorException("Binary tensor coordinates exceed the mode widths");
+	}
+	mapping = file;
+}
+
+void CooTensor::write_binary(const string & filename) const {
+	ofstream os(filename, ios::binary);
+	if (!os.is_open()) {
+		throw TensorException("Cannot create the output tensor file");
+	}
+
+	BinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	header.version = BINARY_VERSION;
+	header.dimension = num_modes;
+	header.nnz = num_nonzeros;
+	header.flags = values_exist ? BINARY_HAS_VALUES : 0;
+
+	write_padded(os, &header, sizeof(header));
+	write_padded(os, widths.data(), num_modes * sizeof(uint));
+	for (uint mode = 0; mode < num_modes; mode++) {
+		write_padded(os, coordinates(mode), num_nonzeros * sizeof(uint));
+	}
+	if (values_exist) {
+		os.write(reinterpret_cast<const char *>(values()), num_nonzeros * sizeof(double));
+	}
+	if (!os) {
+		throw TensorException("Cannot write the output tensor file");
+	}
+}
+}
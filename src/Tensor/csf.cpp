@@ -0,0 +1,134 @@
+#include "csf.hpp"
+#include "../Common/radix_sort.hpp"
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+namespace tensor
+{
+
+// Class CsfTensor
+
+CsfTensor::CsfTensor() { }
+
+CsfTensor::CsfTensor(const CooTensor & coo, const vector<uint> & mode_order, uint num_threads,
+	const vector< vector<uint> > * relabeling)
+	: order(mode_order) {
+	const uint dimension = coo.dimension();
+	vector<bool> seen(dimension, false);
+	for (uint level = 0; level < order.size(); level++) {
+		if (order[level] >= dimension || seen[order[level]]) {
+			throw TensorException("CSF mode order must list every mode of the tensor once");
+		}
+		seen[order[level]] = true;
+	}
+	if (order.size() != dimension) {
+		throw TensorException("CSF mode order must list every mode of the tensor once");
+	}
+	const uint64_t nnz = coo.nnz();
+	if (relabeling != nullptr && relabeling->size() != dimension) {
+		throw TensorException("CSF relabeling must have one table per mode");
+	}
+
+	// coordinate of nonzero i on level l, read through the table of the mode when there is one
+	vector<const uint *> coordinates(dimension), tables(dimension, nullptr);
+	for (uint level = 0; level < dimension; level++) {
+		coordinates[level] = coo.coordinates(order[level]);
+		if (relabeling != nullptr) {
+			const vector<uint> & table = (*relabeling)[order[level]];
+			if (nnz != 0 && *max_element(coordinates[level], coordinates[level] + nnz) >= table.size()) {
+				throw TensorException("Tensor coordinates exceed the relabeling of their mode");
+			}
+			tables[level] = table.data();
+		}
+	}
+	// the sort permutes nonzero indices, 32 bit ones halve its memory traffic whenever they can hold every nonzero
+	if (nnz <= UINT_MAX) {
+		build<uint32_t>(coordinates, tables, nnz, coo.has_values() ? coo.values() : nullptr, num_threads);
+	}
+	else {
+		build<uint64_t>(coordinates, tables, nnz, coo.has_values() ? coo.values() : nullptr, num_threads);
+	}
+}
+
+// Class CsfTensor | Private Member Function Definitions
+
+template <typename Index>
+void CsfTensor::build(const vector<const uint *> & coordinates, const vector<const uint *> & tables, uint64_t nnz,
+	const double * values, uint num_threads) {
+	const uint dimension = order.size();
+	auto coordinate = [&](uint level, Index i) {
+		return tables[level] != nullptr ? tables[level][coordinates[level][i]] : coordinates[level][i];
+	};
+
+	// 1 - Sort the nonzeros. LSD order: starting from the least significant modes, as many modes as fit
+	// are packed into one key [each takes the bits of its largest coordinate] and sorted by one stable radix sort
+	vector<uint> bits(dimension, 0);
+	for (uint level = 0; level < dimension; level++) {
+		uint max_coordinate = 0;
+		for (Index i = 0; i < nnz; i++) {
+			max_coordinate = max(max_coordinate, coordinate(level, i));
+		}
+		bits[level] = common::bits_for(max_coordinate);
+	}
+	vector<Index> sorted(nnz);
+	for (Index i = 0; i < nnz; i++) {
+		sorted[i] = i;
+	}
+	{
+		vector<uint64_t> keys(nnz);
+		int last = static_cast<int>(dimension) - 1;
+		while (last >= 0) {
+			uint key_bits = 0;
+			int first = last;
+			while (first >= 0 && key_bits + bits[first] <= 64) {
+				key_bits += bits[first];
+				first--;
+			}
+			for (Index i = 0; i < nnz; i++) {
+				uint64_t key = 0;
+				for (int level = first + 1; level <= last; level++) {
+					key = key << bits[level] | coordinate(level, sorted[i]);
+				}
+				keys[i] = key;
+			}
+			common::radix_sort(keys, sorted, key_bits, num_threads);
+			last = first;
+		}
+	}
+
+	// 2 - Walk the sorted nonzeros, a nonzero opens a node on every level from the first one where
+	// its coordinate differs from the previous nonzero's, the leaf level always gets a node
+	ids.assign(dimension, vector<uint>());
+	pointers.assign(dimension > 0 ? dimension - 1 : 0, vector<uint64_t>());
+	if (dimension > 0) {
+		ids.back().reserve(nnz);
+	}
+	for (Index i = 0; i < nnz; i++) {
+		uint level = 0;
+		if (i != 0) {
+			while (level + 1 < dimension
+				&& coordinate(level, sorted[i]) == coordinate(level, sorted[i - 1])) {
+				level++;
+			}
+		}
+		for (; level < dimension; level++) {
+			if (level + 1 < dimension) {
+				pointers[level].push_back(ids[level + 1].size()); // its first child is the node opened next
+			}
+			ids[level].push_back(coordinate(level, sorted[i]));
+		}
+	}
+	for (uint level = 0; level + 1 < dimension; level++) {
+		pointers[level].push_back(ids[level + 1].size());
+	}
+
+	if (values != nullptr) {
+		leaf_values.resize(nnz);
+		for (Index i = 0; i < nnz; i++) {
+			leaf_values[i] = values[sorted[i]];
+		}
+	}
+}
+}
@@ -0,0 +1,48 @@
+#ifndef _CSF_HPP
+#define _CSF_HPP
+
+#include <vector>
+#include <cstdint>
+#include "tensor.hpp"
+
+namespace tensor
+{
+// Sparse tensor in compressed sparse fiber (CSF) format: a tree whose level l holds the distinct
+// coordinates of mode <mode_order[l]> under each node of level l - 1. The leaves are the nonzeros,
+// so a node of the level above the leaves is a fiber of the last mode in the order.
+//   fiber_ids(l)[n] is the coordinate of node n of level l
+//   the children of node n of level l are the nodes [fiber_pointers(l)[n], fiber_pointers(l)[n + 1]) of level l + 1
+// Nonzeros with equal coordinates stay separate leaves
+class CsfTensor {
+public:
+	CsfTensor();
+	// Sorts the nonzeros by the modes of <mode_order>, the first mode being the most significant.
+	// When <relabeling> is given, coordinate c of mode m is read as (*relabeling)[m][c]: the tree is
+	// the one of the relabeled tensor, which is never built itself
+	CsfTensor(const CooTensor & coo, const std::vector<uint> & mode_order, uint num_threads = 0,
+		const std::vector< std::vector<uint> > * relabeling = nullptr);
+
+	uint dimension() const { return order.size(); }
+	uint64_t nnz() const { return ids.empty() ? 0 : ids.back().size(); }
+	const std::vector<uint> & mode_order() const { return order; }
+
+	uint64_t node_count(uint level) const { return ids[level].size(); }
+	const uint * fiber_ids(uint level) const { return ids[level].data(); }
+	const uint64_t * fiber_pointers(uint level) const { return pointers[level].data(); } // level < dimension - 1
+	const double * values() const { // in leaf order, nullptr when the tensor has no values
+		return leaf_values.empty() ? nullptr : leaf_values.data();
+	}
+private:
+	std::vector<uint> order;
+	std::vector< std::vector<uint> > ids;
+	std::vector< std::vector<uint64_t> > pointers;
+	std::vector<double> leaf_values;
+
+	// <Index> holds a nonzero index, the constructor picks the narrowest type that fits the nonzero count
+	template <typename Index>
+	void build(const std::vector<const uint *> & coordinates, const std::vector<const uint *> & tables, uint64_t nnz,
+		const double * values, uint num_threads);
+};
+}
+
+#endif
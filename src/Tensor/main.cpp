@@ -0,0 +1,116 @@
+#include <iostream>
+#include "tensor.hpp"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+using namespace std;
+
+namespace tensor
+{
+void packUsage() {
+	cout << "Usage: PURE pack TENSOR -[OPTIONS...]" << endl;
+}
+
+void packHelp() {
+	cout << "Tensor packing tool" << endl
+		<< "-------------------" << endl
+		<< "Converts a COO formatted tensor file into the binary tensor container" << endl;
+	packUsage();
+	cout << "Available options" << endl
+		<< "\t-o FILENAME\t\t sets the name of the output file" << endl
+		<< "\t-no_values \t\t tensor file does NOT contain values" << endl;
+}
+
+void unpackUsage() {
+	cout << "Usage: PURE unpack TENSOR -[OPTIONS...]" << endl;
+}
+
+void unpackHelp() {
+	cout << "Tensor unpacking tool" << endl
+		<< "---------------------" << endl
+		<< "Converts a binary tensor container back into a COO formatted tensor file" << endl;
+	unpackUsage();
+	cout << "Available options" << endl
+		<< "\t-o FILENAME\t\t sets the name of the output file" << endl;
+}
+
+// Shared by pack & unpack, the two commands differ only in the writer that is used
+int convertContainer(int argc, char * argv[], bool pack) {
+	cout << "************************************" << endl;
+	vector<string> arguments(argc);
+	for (int i = 0; i < argc; i++) {
+		arguments[i] = string(argv[i]);
+	}
+
+	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
+		pack ? packHelp() : unpackHelp();
+		exit(0);
+	}
+	else if (argc < 2) {
+		pack ? packUsage() : unpackUsage();
+		exit(0);
+	}
+
+	bool values_exist = true;
+	string input_file;
+	string output_file = pack ? "packed_tensor.bin" : "unpacked_tensor.tns";
+	for (int i = 1; i < argc; i++) {
+		if (arguments[i] == "-o") {
+			if (i + 1 >= argc || arguments[i + 1][0] == '-') {
+				cerr << "expected filename for output, didn't find one!" << endl;
+				exit(1);
+			}
+			i++;
+			output_file = arguments[i];
+		}
+		else if (arguments[i] == "-no_values" && pack) {
+			values_exist = false;
+		}
+		else if (arguments[i][0] != '-' && input_file == "") {
+			input_file = arguments[i];
+		}
+		else {
+			cerr << "Unknown argument encountered: " << arguments[i] << endl;
+			exit(1);
+		}
+	}
+
+	if (input_file == "") {
+		cerr << "A tensor file must be provided!" << endl;
+		exit(1);
+	}
+
+	try {
+		chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
+		CooTensor coo(input_file, values_exist);
+		end = chrono::high_resolution_clock::now();
+		cout << "Read " << coo.nnz() << " nonzeros [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+
+		begin = chrono::high_resolution_clock::now();
+		if (pack) {
+			coo.write_binary(output_file);
+		}
+		else {
+			coo.write_text(output_file);
+		}
+		end = chrono::high_resolution_clock::now();
+		cout << "Wrote " << output_file << " [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+	}
+	catch (TensorException & exc) {
+		cerr << "Error occured: " << exc.what() << endl;
+		exit(1);
+	}
+
+	cout << "************************************" << endl;
+	return 0;
+}
+
+int packMain(int argc, char * argv[]) {
+	return convertContainer(argc, argv, true);
+}
+
+int unpackMain(int argc, char * argv[]) {
+	return convertContainer(argc, argv, false);
+}
+}
@@ -0,0 +1,225 @@
+#include "tensor.hpp"
+#include "../Common/mapped_file.hpp"
+#include "../Common/parallel.hpp"
+#include "../Common/text_parse.hpp"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+using namespace std;
+namespace tensor
+{
+namespace
+{
+// Files smaller than this are parsed by a single thread, spawning workers costs more than it saves
+const size_t MIN_BYTES_PER_THREAD = 1 << 20;
+}
+
+// Class CooTensor
+
+CooTensor::CooTensor()
+	: num_modes(0), num_nonzeros(0), values_exist(false), coordinate_stride(0),
+	mapped_coordinates(nullptr), mapped_values(nullptr) { }
+
+CooTensor::CooTensor(const string & filename, bool has_values, uint num_threads)
+	: num_modes(0), num_nonzeros(0), values_exist(has_values), coordinate_stride(0),
+	mapped_coordinates(nullptr), mapped_values(nullptr) {
+	shared_ptr<common::MappedFile> file;
+	try {
+		file = make_shared<common::MappedFile>(filename);
+	}
+	catch (const common::MappedFileException & exc) {
+		throw TensorException(exc.what());
+	}
+
+	if (file->size() >= sizeof(BINARY_MAGIC) && memcmp(file->data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+		map_binary(file, num_threads);
+	}
+	else {
+		parse_text(file->data(), file->data() + file->size(), has_values, num_threads);
+	}
+}
+
+void CooTensor::set_mode_widths(const vector<uint> & mode_widths) {
+	if (mode_widths.size() != num_modes) {
+		throw TensorException("Number of mode widths doesn't match the tensor dimension");
+	}
+	widths = mode_widths;
+}
+
+// Class CooTensor | Private Member Function Definitions
+
+void CooTensor::parse_text(const char * data, const char * end, bool has_values, uint num_threads) {
+	// 1 - Skip the comments on top of the file, the first one may carry the mode widths
+	vector<uint> header_widths;
+	bool first_comment = true;
+	const char * position = data;
+	while (position != end) {
+		const char * line = common::skip_blanks(position, end);
+		if (line != end && *line == '%') {
+			if (first_comment) {
+				line++;
+				uint64_t width;
+				while (common::parse_uint(line, end, width)) {
+					header_widths.push_back(static_cast<uint>(width));
+				}
+				first_comment = false;
+			}
+		}
+		else if (line != end && *line != '\n') {
+			break;
+		}
+		position = common::next_line(position, end);
+	}
+	const char * data_begin = position;
+
+	// 2 - Determine the dimension from the number of tokens in the first record
+	if (data_begin == end) {
+		throw TensorException("Tensor file doesn't contain any nonzeros");
+	}
+	uint num_tokens = 0;
+	for (const char * token = common::skip_blanks(data_begin, end); token != end && *token != '\n'; token = common::skip_blanks(token, end)) {
+		num_tokens++;
+		while (token != end && !common::is_blank(*token) && *token != '\n') {
+			token++;
+		}
+	}
+	num_modes = has_values ? num_tokens - 1 : num_tokens;
+	if (num_tokens == 0 || num_modes == 0) {
+		throw TensorException("Tensor file has no coordinates");
+	}
+
+	// 3 - Split the records into newline aligned chunks, one per thread
+	if (num_threads == 0) {
+		num_threads = common::default_thread_count();
+	}
+	const size_t data_length = end - data_begin;
+	num_threads = max<size_t>(1, min<size_t>(num_threads, data_length / MIN_BYTES_PER_THREAD));
+	vector<const char *> chunk_begin(num_threads + 1);
+	chunk_begin[0] = data_begin;
+	chunk_begin[num_threads] = end;
+	for (uint i = 1; i < num_threads; i++) {
+		const char * boundary = data_begin + data_length * i / num_threads;
+		if (boundary[-1] != '\n') {
+			boundary = common::next_line(boundary, end);
+		}
+		chunk_begin[i] = max(boundary, chunk_begin[i - 1]);
+	}
+
+	// 4 - Count the records of every chunk and compute where each chunk writes to
+	vector<uint64_t> chunk_offset(num_threads + 1, 0);
+	common::run_threads(num_threads, [&](uint chunk) {
+		uint64_t records = 0;
+		for (const char * line = chunk_begin[chunk]; line != chunk_begin[chunk + 1]; line = common::next_line(line, end)) {
+			if (common::is_record(line, end)) {
+				records++;
+			}
+		}
+		chunk_offset[chunk + 1] = records;
+	});
+	for (uint i = 0; i < num_threads; i++) {
+		chunk_offset[i + 1] += chunk_offset[i];
+	}
+	num_nonzeros = chunk_offset[num_threads];
+	coordinate_stride = num_nonzeros;
+	coordinate_storage.resize(num_modes * num_nonzeros);
+	if (has_values) {
+		value_storage.resize(num_nonzeros);
+	}
+
+	// 5 - Parse the chunks in parallel, every thread keeps the largest coordinate of each mode it has seen
+	vector< vector<uint> > chunk_max(num_threads, vector<uint>(num_modes, 0));
+	atomic<bool> malformed(false);
+	common::run_threads(num_threads, [&](uint chunk) {
+		uint64_t index = chunk_offset[chunk];
+		uint * max_coordinate = chunk_max[chunk].data();
+		for (const char * line = chunk_begin[chunk]; line != chunk_begin[chunk + 1]; line = common::next_line(line, end)) {
+			if (!common::is_record(line, end)) {
+				continue;
+			}
+			const char * token = line;
+			for (uint mode = 0; mode < num_modes; mode++) {
+				uint64_t coordinate;
+				if (!common::parse_uint(token, end, coordinate) || coordinate > UINT32_MAX) {
+					malformed = true;
+					return;
+				}
+				coordinate_storage[mode * num_nonzeros + index] = static_cast<uint>(coordinate);
+				max_coordinate[mode] = max(max_coordinate[mode], static_cast<uint>(coordinate));
+			}
+			if (has_values && !common::parse_double(token, end, value_storage[index])) {
+				malformed = true;
+				return;
+			}
+			index++;
+		}
+	});
+	if (malformed) {
+		throw TensorException("Tensor file contains a malformed nonzero");
+	}
+
+	// 6 - Use the widths from the header if they are consistent with the coordinates
+	widths.assign(num_modes, 0);
+	for (uint chunk = 0; chunk < num_threads; chunk++) {
+		for (uint mode = 0; mode < num_modes; mode++) {
+			widths[mode] = max(widths[mode], chunk_max[chunk][mode] + 1);
+		}
+	}
+	if (header_widths.size() == num_modes) {
+		for (uint mode = 0; mode < num_modes; mode++) {
+			widths[mode] = max(widths[mode], header_widths[mode]);
+		}
+	}
+}
+
+void CooTensor::write_text(const string & filename) const {
+	ofstream os(filename, ios::binary);
+	if (!os.is_open()) {
+		throw TensorException("Cannot create the output tensor file");
+	}
+
+	// header info - mode widths & nnz, the same header random_tensor writes
+	os << "% ";
+	for (uint mode = 0; mode < num_modes; mode++) {
+		os << widths[mode] << " ";
+	}
+	os << "\n% " << num_nonzeros << "\n";
+
+	const size_t flush_threshold = 1 << 20;
+	string buffer;
+	buffer.reserve(flush_threshold + 256);
+	char number[32];
+	for (uint64_t i = 0; i < num_nonzeros; i++) {
+		for (uint mode = 0; mode < num_modes; mode++) {
+			const int length = snprintf(number, sizeof(number), mode + 1 < num_modes || values_exist ? "%u " : "%u", coordinates(mode)[i]);
+			buffer.append(number, length);
+		}
+		if (values_exist) {
+			buffer.append(number, format_value(values()[i], number));
+		}
+		buffer.push_back('\n');
+		if (buffer.size() >= flush_threshold) {
+			os.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	}
+	os.write(buffer.data(), buffer.size());
+	if (!os) {
+		throw TensorException("Cannot write the output tensor file");
+	}
+}
+
+int format_value(double value, char * buffer) {
+	int length = snprintf(buffer, 32, "%.15g", value);
+	if (strtod(buffer, nullptr) != value) {
+		length = snprintf(buffer, 32, "%.17g", value);
+	}
+	return length;
+}
+}
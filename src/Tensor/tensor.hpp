@@ -0,0 +1,103 @@
+#ifndef _TENSOR_HPP
+#define _TENSOR_HPP
+
+#include <vector>
+#include <string>
+#include <exception>
+#include <memory>
+#include <cstdint>
+
+namespace common
+{
+class MappedFile;
+}
+
+namespace tensor
+{
+typedef unsigned int uint;
+
+// Binary tensor container, every section starts at an 8 byte aligned offset:
+//   BinaryHeader
+//   uint32 mode widths [dimension]
+//   uint32 coordinates [dimension][nnz] (mode by mode)
+//   double values [nnz] (only if BINARY_HAS_VALUES is set)
+const char BINARY_MAGIC[8] = { 'P', 'U', 'R', 'E', 'T', 'N', 'S', '\0' };
+const uint BINARY_VERSION = 1;
+const uint BINARY_HAS_VALUES = 1;
+
+struct BinaryHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t dimension;
+	uint64_t nnz;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+// Sparse tensor in coordinate (COO) format kept as a structure of arrays:
+// the coordinates of one mode are contiguous for all nonzeros
+class CooTensor {
+public:
+	CooTensor();
+	// Loads either a binary tensor container [mapped into memory, nothing is copied] or
+	// a FROSTT formatted (.tns) file, where lines starting with '%' are treated as comments.
+	// If the first comment line lists one width per mode (% w1 w2 ... wN), those widths are used,
+	// otherwise the width of a mode is its largest coordinate + 1
+	explicit CooTensor(const std::string & filename, bool has_values = true, uint num_threads = 0);
+
+	uint dimension() const { return num_modes; }
+	uint64_t nnz() const { return num_nonzeros; }
+	bool has_values() const { return values_exist; }
+	const std::vector<uint> & mode_widths() const { return widths; }
+
+	const uint * coordinates(uint mode) const {
+		return (mapping ? mapped_coordinates : coordinate_storage.data()) + mode * coordinate_stride;
+	}
+	const double * values() const { // nullptr when the file has no values
+		return values_exist ? (mapping ? mapped_values : value_storage.data()) : nullptr;
+	}
+	bool is_mapped() const { return static_cast<bool>(mapping); }
+
+	void set_mode_widths(const std::vector<uint> & mode_widths);
+	void write_binary(const std::string & filename) const;
+	void write_text(const std::string & filename) const;
+private:
+	uint num_modes;
+	uint64_t num_nonzeros;
+	bool values_exist;
+	std::vector<uint> widths;
+	std::vector<uint> coordinate_storage; // coordinate of nonzero i in mode m is at [m * nnz + i]
+	std::vector<double> value_storage;
+	uint64_t coordinate_stride; // distance between the coordinate arrays of consecutive modes
+
+	// binary containers are used in place, the mapping is shared between copies of the tensor
+	std::shared_ptr<common::MappedFile> mapping;
+	const uint * mapped_coordinates;
+	const double * mapped_values;
+
+	void parse_text(const char * data, const char * end, bool has_values, uint num_threads);
+	void map_binary(const std::shared_ptr<common::MappedFile> & file, uint num_threads);
+};
+
+
+// Writes the shortest representation of <value> that reads back to the same double,
+// returns the number of characters written into <buffer> [at least 32 bytes]
+int format_value(double value, char * buffer);
+
+// =====================
+// EXCEPTION CLASS BELOW
+// =====================
+
+class TensorException : public std::exception {
+public:
+	TensorException(const char * msg) : msg(msg) { }
+
+	const char * what() const noexcept {
+		return msg;
+	}
+private:
+	const char * msg;
+};
+}
+
+#endif
@@ -1,78 +1,165 @@
 #include <iostream>
+#include <fstream>
 #include "tmetrics.hpp"
+#include "report.hpp"
+#include "../RelabelTensor/relabel.hpp"
 #include <chrono>
 #include <string>
+#include <vector>
 #include <algorithm>
+#include <cstdlib>
 
 using namespace std;
 
+namespace tmetrics
+{
 void usage() {
-	cout << "Usage: PURE TENSOR -[OPTIONS...]" << endl;
+	cout << "Usage: PURE metrics TENSOR [-p PERMUTATION...] -[OPTIONS...]" << endl;
 }
 
 void help() {
 	cout << "Tensor Ordering Metrics" << endl
-		<< "-----------------------" << endl;
+		<< "-----------------------" << endl
+		<< "TENSOR is a tensor file or a binary tensor container written by pack" << endl
+		<< "With permutation files, the metrics of the tensor relabeled by each one are reported next to the" << endl
+		<< "natural ordering, the relabeled tensors are never written" << endl;
 	usage();
-	cout << "Avaiable options:" << endl
+	cout << "Available options:" << endl
 		<< "\t-no_values \t\t tensor file does NOT contain values" << endl
+		<< "\t-p FILENAME\t\t permutation file [as rcm & rabbit write it], may be repeated" << endl
+		<< "\t-format FORMAT\t\t text [default], json or csv" << endl
+		<< "\t-o FILENAME\t\t writes the report into FILENAME instead of the standard output" << endl
+		<< "\t-threads N\t\t number of threads, modes are handled concurrently" << endl
 		<< "\t-v \t\t verbose, i.e. prints timing info" << endl;
 }
 
-int main(int argc, char * argv[]) {
-	cout << "****************************************" << endl;
+int metricsMain(int argc, char * argv[]) {
 	// 0 - Parse CLI arguments
 	vector<string> arguments(argc);
-	int nnz = -1, dimension = -1;
 	for (int i = 0; i < argc; i++) {
 		arguments[i] = string(argv[i]);
 	}
 
-	bool values_exist = true, zero_based = false, verbose = false;;
-
 	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
 		help();
 		exit(0);
-		cout << "****************************************" << endl;
 	}
 	else if (argc < 2) {
 		usage();
 		exit(0);
-		cout << "****************************************" << endl;
 	}
 
-	if (find(begin(arguments), end(arguments), "-no_values") != end(arguments)) {
-		cout << "COO contains coordinates only" << endl;
-		values_exist = false;
+	bool values_exist = true, verbose = false;
+	uint num_threads = 0;
+	string file, format = "text", output_file;
+	vector<string> permutation_files;
+	for (int i = 1; i < argc; i++) {
+		if (arguments[i] == "-no_values") {
+			values_exist = false;
+		}
+		else if (arguments[i] == "-v") {
+			verbose = true;
+		}
+		else if (arguments[i] == "-format" || arguments[i] == "-o" || arguments[i] == "-threads" || arguments[i] == "-p") {
+			if (i + 1 >= argc || arguments[i + 1][0] == '-') {
+				cerr << "expected a value after " << arguments[i] << ", didn't find one!" << endl;
+				exit(1);
+			}
+			const string & value = arguments[++i];
+			if (arguments[i - 1] == "-format") {
+				format = value;
+			}
+			else if (arguments[i - 1] == "-o") {
+				output_file = value;
+			}
+			else if (arguments[i - 1] == "-p") {
+				permutation_files.push_back(value);
+			}
+			else {
+				num_threads = atoi(value.c_str());
+			}
+		}
+		else if (arguments[i][0] != '-' && file == "") {
+			file = arguments[i];
+		}
+		else { // unknown argument!
+			cerr << "Unknown argument encountered: " << arguments[i] << endl;
+			exit(1);
+		}
 	}
-	if (find(begin(arguments), end(arguments), "-v") != end(arguments)) {
-		cout << "Verbose mode" << endl;
-		verbose = true;
+	if (file == "") {
+		cerr << "A tensor file must be provided" << endl
+			<< "PURE metrics --help for more info" << endl;
+		exit(1);
+	}
+	if (format != "text" && format != "json" && format != "csv") {
+		cerr << "Unknown report format " << format << ", expected text, json or csv" << endl;
+		exit(1);
 	}
 
-	string file;
-	for (vector<string>::const_iterator it = arguments.cbegin() + 1; it != arguments.cend() && file == ""; it++) {
-		if (it->at(0) != '-') {
-			file = *it;
+	// 1 - Compute the metrics, only the report goes to the output so json & csv can be piped
+	ofstream output;
+	if (output_file != "") {
+		output.open(output_file);
+		if (!output.is_open()) {
+			cerr << "Cannot create the report file " << output_file << endl;
+			exit(1);
 		}
 	}
-	if (file == "") {
-		cout << "A tensor file must be provided" << endl
-			<< "PURE --help for more info" << endl;
+	ostream & os = output_file != "" ? output : cout;
+	if (format == "text") {
+		os << "****************************************" << endl;
+		if (!values_exist) {
+			os << "COO contains coordinates only" << endl;
+		}
+	}
+
+	// the tensor is read once, every permutation only swaps the tables its coordinates are read through
+	vector<MetricsReport> reports;
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+	try {
+		Tmetrics metric_calculator(file, !values_exist, num_threads);
+		double load_ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+		reports.push_back(compute_report(metric_calculator, file, "natural", load_ms));
+
+		for (uint i = 0; i < permutation_files.size(); i++) {
+			begin = chrono::high_resolution_clock::now();
+			vector<uint> widths, labels;
+			relabel::read_permutation_file(permutation_files[i], widths, labels);
+			relabel::Relabel relabel_obj(labels, widths, false, num_threads);
+			try {
+				metric_calculator.set_relabeling(relabel_obj.relabeling());
+			}
+			catch (tensor::TensorException & exc) {
+				cerr << "Permutation " << permutation_files[i] << " doesn't fit the tensor: " << exc.what() << endl;
+				exit(1);
+			}
+			load_ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+			reports.push_back(compute_report(metric_calculator, file, permutation_files[i], load_ms));
+		}
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot read the provided tensor file: " << exc.what() << endl;
 		exit(1);
-		cout << "****************************************" << endl;
 	}
 
-	// 1 - Compute the metrics
-	
-	Tmetrics metric_calculator(file, !values_exist, verbose);
-	
-	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now(), end;
-	metric_calculator.mode_dependent_metrics();
-	metric_calculator.mode_independent_metrics();
-	end = chrono::high_resolution_clock::now();
-	cout << "----------------------------------------" << endl
-		<< "Timing Info: " << endl
-		<< "Total: " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms" << endl;
+	if (format == "json") {
+		write_json(reports, os);
+	}
+	else if (format == "csv") {
+		write_csv(reports, os);
+	}
+	else {
+		for (uint i = 0; i < reports.size(); i++) {
+			if (reports.size() > 1) {
+				os << "Ordering: " << reports[i].ordering << endl;
+			}
+			write_text(reports[i], os, verbose);
+		}
+		if (reports.size() > 1) {
+			write_comparison(reports, os);
+		}
+	}
 	return 0;
-}
\ No newline at end of file
+}
+}
@@ -0,0 +1,204 @@
+#include "report.hpp"
+#include "../Tensor/tensor.hpp"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+namespace tmetrics
+{
+namespace
+{
+// Shortest text that reads back to the same double, JSON has no NaN or infinity so those are written as null
+string number(double value) {
+	if (!std::isfinite(value)) {
+		return "null";
+	}
+	char buffer[32];
+	return string(buffer, tensor::format_value(value, buffer));
+}
+
+string json_string(const string & text) {
+	string quoted = "\"";
+	for (string::const_iterator it = text.begin(); it != text.end(); it++) {
+		if (*it == '"' || *it == '\\') {
+			quoted += '\\';
+			quoted += *it;
+		}
+		else if (static_cast<unsigned char>(*it) < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*it));
+			quoted += escaped;
+		}
+		else {
+			quoted += *it;
+		}
+	}
+	return quoted + "\"";
+}
+
+// Quoted only when the field would break the row
+string csv_field(const string & text) {
+	if (text.find_first_of(",\"\n\r") == string::npos) {
+		return text;
+	}
+	string quoted = "\"";
+	for (string::const_iterator it = text.begin(); it != text.end(); it++) {
+		quoted += *it;
+		if (*it == '"') {
+			quoted += '"';
+		}
+	}
+	return quoted + "\"";
+}
+}
+
+MetricsReport compute_report(const Tmetrics & metrics, const string & tensor_file, const string & ordering, double load_ms) {
+	MetricsReport report;
+	report.tensor_file = tensor_file;
+	report.ordering = ordering;
+	report.nnz = metrics.nnz();
+	report.dimensions = metrics.dimensions();
+	report.load_ms = load_ms;
+
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+	report.modes = metrics.mode_dependent_metrics();
+	report.independent = metrics.mode_independent_metrics();
+	report.total_ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+	return report;
+}
+
+void write_text(const MetricsReport & report, ostream & os, bool verbose) {
+	os << "line count: " << report.nnz << endl;
+	if (verbose) {
+		os << "Tensor file read [" << static_cast<long long>(report.load_ms) << " ms]" << endl;
+	}
+	os << "Dimensions: ";
+	for (uint mode = 0; mode < report.dimensions.size(); mode++) {
+		os << (mode == 0 ? "" : "x") << report.dimensions[mode];
+	}
+	os << endl;
+
+	os << "--------- Mode Dependent Metrics ---------" << endl
+		<< "<avg. fiber bandwidth> <avg. fiber density>" << endl;
+	for (uint mode = 0; mode < report.modes.size(); mode++) {
+		const ModeDependentMetrics & metrics = report.modes[mode];
+		if (verbose) {
+			os << "CSF tree of mode " << mode << " built [" << static_cast<long long>(metrics.build_ms) << " ms], "
+				<< metrics.fiber_count << " fibers [" << static_cast<long long>(metrics.metric_ms) << " ms]" << endl;
+		}
+		os << metrics.nnz_count << endl;
+		os << endl << "mode " << mode << ": " << metrics.fiber_bandwidth << " " << metrics.fiber_density << endl << endl;
+	}
+
+	os << "-------- Mode Independent Metrics --------" << endl;
+	if (verbose) {
+		os << "Mode independent metrics computed [" << static_cast<long long>(report.independent.metric_ms) << " ms]" << endl;
+	}
+	os << "average distance to diagonal: " << report.independent.distance_to_diagonal << endl
+		<< "average normalized pairwise difference: " << report.independent.normalized_pairwise_difference << endl
+		<< "average pairwise difference: " << report.independent.pairwise_difference << endl;
+	os << "----------------------------------------" << endl
+		<< "Timing Info: " << endl
+		<< "Total: " << static_cast<long long>(report.total_ms) << " ms" << endl;
+}
+
+void write_comparison(const vector<MetricsReport> & reports, ostream & os) {
+	// name & value of every compared metric
+	vector< vector< pair<string, double> > > rows(reports.size());
+	for (uint i = 0; i < reports.size(); i++) {
+		const MetricsReport & report = reports[i];
+		for (uint mode = 0; mode < report.modes.size(); mode++) {
+			rows[i].push_back(make_pair("mode " + to_string(mode) + " fiber bandwidth", report.modes[mode].fiber_bandwidth));
+			rows[i].push_back(make_pair("mode " + to_string(mode) + " fiber density", report.modes[mode].fiber_density));
+		}
+		rows[i].push_back(make_pair("average distance to diagonal", report.independent.distance_to_diagonal));
+		rows[i].push_back(make_pair("average normalized pairwise difference", report.independent.normalized_pairwise_difference));
+		rows[i].push_back(make_pair("average pairwise difference", report.independent.pairwise_difference));
+	}
+
+	os << "------------ Ordering Comparison ------------" << endl;
+	for (uint i = 1; i < reports.size(); i++) {
+		os << reports[0].ordering << " -> " << reports[i].ordering << endl;
+		for (uint row = 0; row < rows[0].size(); row++) {
+			const double before = rows[0][row].second, after = rows[i][row].second;
+			os << "\t" << rows[0][row].first << ": " << before << " -> " << after;
+			if (before != 0) {
+				os << " (" << (after - before) / before * 100 << "%)";
+			}
+			os << endl;
+		}
+	}
+}
+
+void write_json(const vector<MetricsReport> & reports, ostream & os) {
+	// a single report stays a plain object
+	const string indent = reports.size() == 1 ? "" : "  ";
+	if (reports.size() != 1) {
+		os << "[" << endl;
+	}
+	for (uint i = 0; i < reports.size(); i++) {
+		const MetricsReport & report = reports[i];
+		os << indent << "{" << endl
+			<< indent << "  \"tensor\": " << json_string(report.tensor_file) << "," << endl
+			<< indent << "  \"ordering\": " << json_string(report.ordering) << "," << endl
+			<< indent << "  \"nnz\": " << report.nnz << "," << endl
+			<< indent << "  \"dimensions\": [";
+		for (uint mode = 0; mode < report.dimensions.size(); mode++) {
+			os << (mode == 0 ? "" : ", ") << report.dimensions[mode];
+		}
+		os << "]," << endl
+			<< indent << "  \"modes\": [";
+		for (uint mode = 0; mode < report.modes.size(); mode++) {
+			const ModeDependentMetrics & metrics = report.modes[mode];
+			os << (mode == 0 ? "" : ",") << endl
+				<< indent << "    {\"mode\": " << mode
+				<< ", \"fiber_count\": " << metrics.fiber_count
+				<< ", \"fiber_bandwidth\": " << number(metrics.fiber_bandwidth)
+				<< ", \"fiber_density\": " << number(metrics.fiber_density)
+				<< ", \"build_ms\": " << number(metrics.build_ms)
+				<< ", \"metric_ms\": " << number(metrics.metric_ms) << "}";
+		}
+		os << endl << indent << "  ]," << endl
+			<< indent << "  \"mode_independent\": {"
+			<< "\"distance_to_diagonal\": " << number(report.independent.distance_to_diagonal)
+			<< ", \"normalized_pairwise_difference\": " << number(report.independent.normalized_pairwise_difference)
+			<< ", \"pairwise_difference\": " << number(report.independent.pairwise_difference)
+			<< ", \"metric_ms\": " << number(report.independent.metric_ms) << "}," << endl
+			<< indent << "  \"timings\": {\"load_ms\": " << number(report.load_ms) << ", \"total_ms\": " << number(report.total_ms) << "}" << endl
+			<< indent << "}" << (i + 1 < reports.size() ? "," : "") << endl;
+	}
+	if (reports.size() != 1) {
+		os << "]" << endl;
+	}
+}
+
+void write_csv(const vector<MetricsReport> & reports, ostream & os) {
+	os << "tensor,ordering,mode,metric,value" << endl;
+	for (uint i = 0; i < reports.size(); i++) {
+		const MetricsReport & report = reports[i];
+		const string row = csv_field(report.tensor_file) + "," + csv_field(report.ordering) + ",";
+		os << row << ",nnz," << report.nnz << endl;
+		for (uint mode = 0; mode < report.dimensions.size(); mode++) {
+			os << row << mode << ",dimension," << report.dimensions[mode] << endl;
+		}
+		for (uint mode = 0; mode < report.modes.size(); mode++) {
+			const ModeDependentMetrics & metrics = report.modes[mode];
+			os << row << mode << ",fiber_count," << metrics.fiber_count << endl
+				<< row << mode << ",fiber_bandwidth," << number(metrics.fiber_bandwidth) << endl
+				<< row << mode << ",fiber_density," << number(metrics.fiber_density) << endl
+				<< row << mode << ",build_ms," << number(metrics.build_ms) << endl
+				<< row << mode << ",metric_ms," << number(metrics.metric_ms) << endl;
+		}
+		os << row << ",distance_to_diagonal," << number(report.independent.distance_to_diagonal) << endl
+			<< row << ",normalized_pairwise_difference," << number(report.independent.normalized_pairwise_difference) << endl
+			<< row << ",pairwise_difference," << number(report.independent.pairwise_difference) << endl
+			<< row << ",mode_independent_ms," << number(report.independent.metric_ms) << endl
+			<< row << ",load_ms," << number(report.load_ms) << endl
+			<< row << ",total_ms," << number(report.total_ms) << endl;
+	}
+}
+}
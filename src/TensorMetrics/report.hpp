@@ -0,0 +1,39 @@
+#ifndef _METRICS_REPORT_HPP
+#define _METRICS_REPORT_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include "tmetrics.hpp"
+
+namespace tmetrics
+{
+// Everything one metrics run measured, written by one of the writers below
+struct MetricsReport {
+	MetricsReport() : nnz(0), load_ms(0), total_ms(0) { }
+
+	std::string tensor_file;
+	std::string ordering; // "natural" or the permutation file the tensor was relabeled with
+	uint64_t nnz;
+	std::vector<uint> dimensions; // largest coordinate of each mode
+	std::vector<ModeDependentMetrics> modes;
+	ModeIndependentMetrics independent;
+	double load_ms; // reading the tensor
+	double total_ms; // computing the metrics
+};
+
+// Runs every metric of <metrics> for its current relabeling
+MetricsReport compute_report(const Tmetrics & metrics, const std::string & tensor_file, const std::string & ordering, double load_ms);
+
+// Human readable report, the format the metrics tool always printed
+void write_text(const MetricsReport & report, std::ostream & os, bool verbose);
+// Every metric of the first report next to its value in each other report
+void write_comparison(const std::vector<MetricsReport> & reports, std::ostream & os);
+// One JSON object per report, several reports make an array
+void write_json(const std::vector<MetricsReport> & reports, std::ostream & os);
+// One <tensor,ordering,mode,metric,value> row per value, the mode is empty for the metrics of the whole tensor
+void write_csv(const std::vector<MetricsReport> & reports, std::ostream & os);
+}
+
+#endif
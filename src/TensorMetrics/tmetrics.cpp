@@ -1,288 +1,270 @@
-#include "tmetrics.hpp"  
+#include "tmetrics.hpp"
+#include "../Tensor/tensor.hpp"
+#include "../Tensor/csf.hpp"
+#include "../Common/parallel.hpp"
 #include <string>
-#include <fstream>
-#include <list>
 #include <vector>
-#include <climits>
 #include <algorithm>
-#include <numeric> // std::inner_product()
-#include <iostream>
-#include <cassert>
-#include <iterator>
 #include <chrono>
 #include <cmath>
-#include <string>
+#include <atomic>
 using namespace std;
 
-Tmetrics::Tmetrics(const string & in_file, bool no_values, bool verbose) 
-	: no_values(no_values), verbose(verbose) {
-	// 0 - Create the input stream
-	ifstream is(in_file);
-	if (!is.is_open()) {
-		cout << "Cannot open the provided tensor file" << endl
-			<< "****************************************" << endl;
-		exit(1);
+namespace tmetrics
+{
+namespace
+{
+// Nonzeros handled together by the mode independent kernel
+const uint INDEPENDENT_BLOCK = 1024;
+
+// Kahan summation, keeps the rounding error of every addition to add it back with the next one
+struct CompensatedSum {
+	CompensatedSum() : sum(0), compensation(0) { }
+
+	void add(double value) {
+		const double corrected = value - compensation;
+		const double next = sum + corrected;
+		compensation = (next - sum) - corrected;
+		sum = next;
 	}
-	// 1 - Determine the dimension of the tensor
-	streampos previous = is.tellg();
-	string buffer;
-	getline(is, buffer);
-	while (buffer.at(0) == '%') {
-	  previous = is.tellg();
-	  getline(is, buffer);
+	void add(const CompensatedSum & other) {
+		add(other.sum);
+		add(-other.compensation);
 	}
-	is.seekg(previous);
-	
-	string first_line;
-	getline(is, first_line);
+	double value() const { return sum - compensation; }
 
-	int dimension = 0, index = 0;
-	while (index != string::npos) {
-		index = first_line.find(' ', index + 1);
-		dimension++;
-	}
+	double sum;
+	double compensation;
+};
 
-	if (!no_values)
-		dimension--;
+// Milliseconds passed since <begin>
+double elapsed_ms(const chrono::high_resolution_clock::time_point & begin) {
+	return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - begin).count();
+}
+}
 
-	// 2 - Read the input stream
-	chrono::high_resolution_clock::time_point begin, end;
-	if (verbose) {
-		cout << "Start: read the tensor file" << endl;
-		begin = chrono::high_resolution_clock::now();
-	}
-	diagonal.resize(dimension, 0);
-	is.seekg(0);
-	uint line_count = 0;
-	while (!is.eof()) {
-		line_count++;
-		vector<uint> current_coordinates(dimension);
-		for (int i = 0; i < dimension; i++) {
-		  if (is.eof()) break;
-			uint component;
-			is >> component;
-			if (is.fail()) break;
+// CLASS Tmetrics
 
-			current_coordinates[i] = component;
-			diagonal[i] = diagonal[i] > component ? diagonal[i] : component;
-		}
-		if (!no_values) {
-			double value;
-			is >> value;
-		}
-		coords.push_back(Coordinate(current_coordinates));
-	}
-	cout << "line count: " << line_count << endl;
-	if (verbose) {
-		end = chrono::high_resolution_clock::now();
-		cout << "End: read the tensor file [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
-	}
+Tmetrics::Tmetrics(const string & in_file, bool no_values, uint num_threads)
+	: owned_tensor(in_file, !no_values, num_threads == 0 ? common::default_thread_count() : num_threads), coo(owned_tensor),
+	num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
+	compute_diagonal();
+}
 
-	cout << "Dimensions: ";
-	for (vector<uint>::const_iterator it = diagonal.cbegin(); it != diagonal.cend(); it++) {
-		cout << *it;
-		if (next(it, 1) != diagonal.end()) {
-			cout << "x";
-		}
-		}
-	cout << endl;
-	
-	diagonal_self_dot_product = dot_product(diagonal, diagonal);
+Tmetrics::Tmetrics(const tensor::CooTensor & coo, uint num_threads)
+	: coo(coo), num_threads(num_threads == 0 ? common::default_thread_count() : num_threads) {
+	compute_diagonal();
 }
 
 // CLASS Tmetrics | Public Member Function Definitions
 
-void Tmetrics::mode_dependent_metrics() {
-	cout << "--------- Mode Dependent Metrics ---------" << endl
-		 << "<avg. fiber bandwidth> <avg. fiber density>" << endl;
-	for (uint i = 0; i < diagonal.size(); i++) {
-		ModeDependentMetrics metrics = fiber_metrics(i);
-		cout << endl << "mode " + to_string(i)  << ": " << metrics.fiber_bandwidth << " " << metrics.fiber_density << endl << endl;
+void Tmetrics::set_relabeling(const vector< vector<uint> > & mode_tables) {
+	if (!mode_tables.empty()) {
+		if (mode_tables.size() != coo.dimension()) {
+			throw tensor::TensorException("Relabeling must have one table per mode of the tensor");
+		}
+		for (uint mode = 0; mode < coo.dimension(); mode++) {
+			if (coo.nnz() != 0 && *max_element(coo.coordinates(mode), coo.coordinates(mode) + coo.nnz()) >= mode_tables[mode].size()) {
+				throw tensor::TensorException("Tensor coordinates exceed the relabeling of their mode");
+			}
+		}
 	}
+	relabeling = mode_tables;
+	compute_diagonal();
 }
 
-void Tmetrics::mode_independent_metrics() const {
+vector<ModeDependentMetrics> Tmetrics::mode_dependent_metrics() const {
+	// Every mode builds its own CSF tree over the shared coordinates, the workers take the next mode when they are done
+	const uint dimension = diagonal.size();
+	const uint workers = min(num_threads, max(dimension, 1u));
+	vector<ModeDependentMetrics> metrics(dimension);
+	atomic<uint> next_mode(0);
+	common::run_threads(workers, [&](uint) {
+		for (uint mode = next_mode++; mode < dimension; mode = next_mode++) {
+			metrics[mode] = fiber_metrics(mode, max(1u, num_threads / workers));
+		}
+	});
+	return metrics;
+}
+
+ModeIndependentMetrics Tmetrics::mode_independent_metrics() const {
 	// Calculation of mode independent metrics are done locally
-	// Computed metrics are: avg. distance to super diagonal, 
+	// Computed metrics are: avg. distance to super diagonal,
 	// avg. normalized pairwise coordinate difference,
-	// avg. pairwise coordinate differenceo
-	cout << "-------- Mode Independent Metrics --------" << endl;
-	chrono::high_resolution_clock::time_point begin, end;
-	if (verbose) {
-		cout << "Start: computation of mode independent metrics" << endl;
-		begin = chrono::high_resolution_clock::now();
-	}
-
-	double distance_average = 0.0;
-	pair<double, double> pairwise_metrics_sum = { 0.0, 0.0 };
-	for (list<Coordinate>::const_iterator coordinate = coords.cbegin(); coordinate != coords.cend(); coordinate++) {
-		distance_average += distance_to_diagonal(coordinate) / coords.size();
-		pair<uint, double> pairwise_metrics = pairwise_difference(coordinate);
-		pairwise_metrics_sum.first += static_cast<double>(pairwise_metrics.first) / coords.size();
-		pairwise_metrics_sum.second += pairwise_metrics.second / coords.size();
+	// avg. pairwise coordinate difference
+	const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+
+	// Every thread sums the metrics of its blocks with compensated summation, the sums of the threads are
+	// added up the same way and divided by the nonzero count once
+	const uint64_t nnz = coo.nnz();
+	const uint64_t block_count = (nnz + INDEPENDENT_BLOCK - 1) / INDEPENDENT_BLOCK;
+	vector<CompensatedSum> distances(num_threads), normalized_differences(num_threads), differences(num_threads);
+	common::parallel_blocks(block_count, num_threads, [&](uint64_t first_block, uint64_t last_block, uint thread_id) {
+		vector<uint> scratch(relabeling.empty() ? 0 : diagonal.size() * INDEPENDENT_BLOCK);
+		for (uint64_t block = first_block; block < last_block; block++) {
+			const uint64_t begin = block * INDEPENDENT_BLOCK;
+			double distance_sum, normalized_sum, difference_sum;
+			independent_block(begin, static_cast<uint>(min<uint64_t>(INDEPENDENT_BLOCK, nnz - begin)), scratch.data(),
+				distance_sum, normalized_sum, difference_sum);
+			distances[thread_id].add(distance_sum);
+			normalized_differences[thread_id].add(normalized_sum);
+			differences[thread_id].add(difference_sum);
+		}
+	});
+	CompensatedSum distance_total, normalized_total, difference_total;
+	for (uint i = 0; i < num_threads; i++) {
+		distance_total.add(distances[i]);
+		normalized_total.add(normalized_differences[i]);
+		difference_total.add(differences[i]);
 	}
 
-	if (verbose) {
-		end = chrono::high_resolution_clock::now();
-		cout << "End: computation of mode independent metrics [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
+	ModeIndependentMetrics metrics;
+	if (nnz != 0) {
+		metrics.distance_to_diagonal = distance_total.value() / nnz;
+		metrics.normalized_pairwise_difference = normalized_total.value() / nnz;
+		metrics.pairwise_difference = difference_total.value() / nnz;
 	}
-	cout << "average distance to diagonal: " << distance_average << endl
-		<< "average normalized pairwise difference: " << pairwise_metrics_sum.second << endl
-		<< "average pairwise difference: " << pairwise_metrics_sum.first << endl;
+	metrics.metric_ms = elapsed_ms(begin);
+	return metrics;
 }
 
 // CLASS Tmetrics | Private Member Function Definitions
 
-ModeDependentMetrics Tmetrics::fiber_metrics(uint mode) {
-	chrono::high_resolution_clock::time_point begin, end;
+void Tmetrics::compute_diagonal() {
+	// The diagonal ends at the largest coordinate of each mode
+	const uint dimension = coo.dimension();
+	diagonal.resize(dimension, 0);
+	for (uint mode = 0; mode < dimension; mode++) {
+		const uint * coordinates = coo.coordinates(mode);
+		diagonal[mode] = 0;
+		if (relabeling.empty()) {
+			for (uint64_t i = 0; i < coo.nnz(); i++) {
+				diagonal[mode] = max(diagonal[mode], coordinates[i]);
+			}
+		}
+		else {
+			const uint * table = relabeling[mode].data();
+			for (uint64_t i = 0; i < coo.nnz(); i++) {
+				diagonal[mode] = max(diagonal[mode], table[coordinates[i]]);
+			}
+		}
+	}
+	diagonal_self_dot_product = 0;
+	for (uint mode = 0; mode < dimension; mode++) {
+		diagonal_self_dot_product += static_cast<double>(diagonal[mode]) * diagonal[mode];
+	}
+}
 
-	// 0 - Create fibers
-	createFibers(mode);
-	fiber_count = fiber_indices.size() - 1;
+ModeDependentMetrics Tmetrics::fiber_metrics(uint mode, uint num_threads) const {
+	ModeDependentMetrics metrics;
+	if (diagonal.size() < 2) {
+		return metrics; // a fiber fixes every other mode, a 1-mode tensor has none
+	}
+
+	// 0 - Create fibers: a CSF tree ordered by every other mode, then by <mode>.
+	// The nodes above the leaves are the fibers of <mode>, their leaves are sorted by the <mode> coordinate
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+	vector<uint> mode_order;
+	for (uint i = 0; i < diagonal.size(); i++) {
+		if (i != mode) {
+			mode_order.push_back(i);
+		}
+	}
+	mode_order.push_back(mode);
+	const tensor::CsfTensor csf(coo, mode_order, num_threads, relabeling.empty() ? nullptr : &relabeling);
+	const uint fiber_level = csf.dimension() - 2;
+	const uint64_t * fiber_pointers = csf.fiber_pointers(fiber_level);
+	const uint * mode_coordinates = csf.fiber_ids(fiber_level + 1);
+	metrics.fiber_count = csf.node_count(fiber_level);
+	metrics.build_ms = elapsed_ms(begin);
 
 	// 1 - For each fiber, compute the bandwidth
 	// [for now] -> compute the average FB of the current mode
-	double average_bandwidth= 0;
+	begin = chrono::high_resolution_clock::now();
+	const uint64_t fiber_count = metrics.fiber_count;
+	double average_bandwidth = 0;
 	double average_density = 0;
-
-	if (verbose) {
-		cout << "Start: Fiber bandwidth & density computation" << endl;
-		begin = chrono::high_resolution_clock::now();
-	}
-
-	list<Coordinate>::const_iterator it = coords.cbegin();
-	uint iterator_position = 0;
-	// traversal over fiber indices
-	uint total_nnz_count = 0;
-	for (list<uint>::const_iterator index = fiber_indices.cbegin(); index != fiber_indices.cend(); index++) {
-		uint low_bound = UINT_MAX, high_bound = 0;
-		uint nnz_count = 0;
-		// traversal over fiber coordinates
-		while (iterator_position <= *index) {
-			low_bound = low_bound < it->coor[mode] ? low_bound : it->coor[mode];
-			high_bound = high_bound > it->coor[mode] ? high_bound : it->coor[mode];
-			nnz_count++;
-			it++;
-			iterator_position++;
-		}
+	uint64_t total_nnz_count = 0;
+	for (uint64_t fiber = 0; fiber < metrics.fiber_count; fiber++) {
+		const uint64_t nnz_count = fiber_pointers[fiber + 1] - fiber_pointers[fiber];
+		const uint low_bound = mode_coordinates[fiber_pointers[fiber]];
+		const uint high_bound = mode_coordinates[fiber_pointers[fiber + 1] - 1];
 		const double bandwidth = high_bound - low_bound + 1; // Bandwidth of one fiber in the mode
 		average_bandwidth += bandwidth / fiber_count;
-		//cout << "fiber count: " << fiber_count << endl;
 		average_density += (bandwidth / nnz_count) / fiber_count;
 		total_nnz_count += nnz_count;
 	}
-	cout << total_nnz_count << endl;
-	if (verbose) {
-		end = chrono::high_resolution_clock::now();
-		cout << "End: Fiber bandwidth & density computation [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
-	}
-
-	ModeDependentMetrics metrics(average_bandwidth, average_density);
+	metrics.fiber_bandwidth = average_bandwidth;
+	metrics.fiber_density = average_density;
+	metrics.nnz_count = total_nnz_count;
+	metrics.metric_ms = elapsed_ms(begin);
 	return metrics;
 }
 
-double Tmetrics::distance_to_diagonal(const list<Coordinate>::const_iterator & coord_iter) const {
-	chrono::high_resolution_clock::time_point begin, end;
-
-	// A = (0, 0, ..., 0) B = (n_1, n_2, ..., n_k) for k-dim. tensor
-	const vector<uint> & P = coord_iter->coor;
-	// PA vector is equivalent to P & BA vector is equivalent to <diagonal>
-
-	double t = dot_product(P, diagonal)
-		/ diagonal_self_dot_product;
-
-	double distance = 0;
-	for (uint i = 0; i < diagonal.size(); i++) {
-		distance += (P[i] - (t * diagonal[i])) * (P[i] - (t * diagonal[i]));
-	}
-	distance = sqrt(distance);
-	
-	return distance;
-}
-
-pair<uint, double> Tmetrics::pairwise_difference(const std::list<Coordinate>::const_iterator & coordinates) const {
-	// Pre-condition: Assumes that the tensor dimension is greater than 1!
-	pair<uint, double> max_values = { 0, INT_MIN };
-
-	for (uint i = 0; i < diagonal.size() - 1; i++) {
-		double normalized_diff;
-		uint diff;
-		for (uint j = i + 1; j < diagonal.size(); j++) {
-			uint component1 = coordinates->coor[i], component2 = coordinates->coor[j];
-			normalized_diff = abs((static_cast<double>(component1) / diagonal[i]) - (static_cast<double>(component2) / diagonal[j]));
-			diff = component1 > component2 ? (component1 - component2) : (component2 - component1);
-		}
-		max_values.first = max(max_values.first, diff);
-		max_values.second = max(max_values.second, normalized_diff);
-	}
-
-	return max_values;
-}
-
-bool Tmetrics::Comparator::operator() (const Coordinate & lhs, const Coordinate & rhs) const {
-	assert(mode < lhs.coor.size() && lhs.coor.size() == rhs.coor.size());
-
-	// operator() implements the `strict less` opearation
-	const uint dimension = lhs.coor.size();
-	for (uint i = 0; i < dimension; i++) {
-		// Treat coordinate values as if mode1 & mode2 were at the end
-		if (i != mode) {
-			if (lhs.coor[i] < rhs.coor[i])
-				return true;
-			else if (lhs.coor[i] > rhs.coor[i])
-				return false;
+void Tmetrics::independent_block(uint64_t begin, uint count, uint * scratch,
+	double & distance_sum, double & normalized_sum, double & difference_sum) const {
+	// Every loop runs over the nonzeros of the block with the mode fixed, so the coordinates are
+	// read as contiguous arrays and the compiler vectorizes the loops for the targeted instruction set
+	const uint dimension = diagonal.size();
+	vector<const uint *> block_coordinates(dimension);
+	for (uint mode = 0; mode < dimension; mode++) {
+		block_coordinates[mode] = coo.coordinates(mode) + begin;
+		if (!relabeling.empty()) { // relabel the block once, every loop below reads it
+			const uint * table = relabeling[mode].data();
+			uint * relabeled = scratch + mode * INDEPENDENT_BLOCK;
+			for (uint k = 0; k < count; k++) {
+				relabeled[k] = table[block_coordinates[mode][k]];
+			}
+			block_coordinates[mode] = relabeled;
 		}
 	}
-	if (lhs.coor[mode] < rhs.coor[mode]) {
-		return true;
+	double projection[INDEPENDENT_BLOCK], distance[INDEPENDENT_BLOCK], normalized_max[INDEPENDENT_BLOCK], difference_max[INDEPENDENT_BLOCK];
+	for (uint k = 0; k < count; k++) {
+		projection[k] = 0;
+		distance[k] = 0;
+		normalized_max[k] = 0;
+		difference_max[k] = 0;
 	}
-	return false;
-}
 
-void Tmetrics::createFibers(uint mode) {
-	// 0 - Sort the coordinates WRT the current mode
-	chrono::high_resolution_clock::time_point begin, end;
-	if (verbose) {
-		cout << "Start: Sorting coordinates WRT mode " << mode << endl;
-		begin = chrono::high_resolution_clock::now();
+	// 1 - Distance to the diagonal: A = (0, 0, ..., 0) B = (n_1, n_2, ..., n_k) for k-dim. tensor
+	// PA vector is equivalent to P & BA vector is equivalent to <diagonal>, t = <P, BA> / <BA, BA>
+	for (uint mode = 0; mode < dimension; mode++) {
+		const uint * coordinates = block_coordinates[mode];
+		const double component = diagonal_self_dot_product == 0 ? 0 : diagonal[mode] / diagonal_self_dot_product;
+		for (uint k = 0; k < count; k++) {
+			projection[k] += coordinates[k] * component;
+		}
 	}
-	Comparator comparison_func(mode);
-	coords.sort(comparison_func);
-	if (verbose) {
-		end = chrono::high_resolution_clock::now();
-		cout << "End: Sorting coordinates WRT mode " << mode << " [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl
-			<< "Start: Detecting fiber indices" << endl;
-		begin = chrono::high_resolution_clock::now();
+	for (uint mode = 0; mode < dimension; mode++) {
+		const uint * coordinates = block_coordinates[mode];
+		const double component = diagonal[mode];
+		for (uint k = 0; k < count; k++) {
+			const double offset = coordinates[k] - projection[k] * component;
+			distance[k] += offset * offset;
+		}
 	}
 
-	// 1 - Detect the indices of fibers
-	fiber_indices.clear();
-	vector<uint> current_coordinates = coords.cbegin()->coor;
-	uint coordinate_index = 1;
-	for (list<Coordinate>::const_iterator it = next(coords.cbegin(), 1); it != coords.cend(); it++, coordinate_index++) {
-		for (uint i = 0; i < it->coor.size(); i++) {
-			if (i != mode && it->coor[i] != current_coordinates[i]) { // if iterator coordinates differ from <current_coordinates>
-				current_coordinates = it->coor;
-				fiber_indices.push_back(coordinate_index - 1);
+	// 2 - Max difference over every pair of modes, raw and with each coordinate normalized by its mode width
+	for (uint i = 0; i + 1 < dimension; i++) {
+		const uint * coordinates1 = block_coordinates[i];
+		const double scale1 = diagonal[i] == 0 ? 0 : 1.0 / diagonal[i];
+		for (uint j = i + 1; j < dimension; j++) {
+			const uint * coordinates2 = block_coordinates[j];
+			const double scale2 = diagonal[j] == 0 ? 0 : 1.0 / diagonal[j];
+			for (uint k = 0; k < count; k++) {
+				const double normalized = fabs(coordinates1[k] * scale1 - coordinates2[k] * scale2);
+				const double difference = fabs(static_cast<double>(coordinates1[k]) - static_cast<double>(coordinates2[k]));
+				normalized_max[k] = normalized_max[k] > normalized ? normalized_max[k] : normalized;
+				difference_max[k] = difference_max[k] > difference ? difference_max[k] : difference;
 			}
 		}
 	}
-	fiber_indices.push_back(coordinate_index - 1); // push the last index to indicate the end of final fiber
-	if (verbose) {
-		end = chrono::high_resolution_clock::now();
-		cout << "End: Detecting fiber indices" << " [" << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << " ms]" << endl;
-	}
-}
-
-// Mark: Class Tmetrics | Utilities
 
-uint Tmetrics::dot_product(const vector<uint> & u1, const vector<uint> & u2) const {
-	assert(u1.size() == u2.size());
-
-	const uint dim = u1.size();
-	uint result = 0;
-	for (uint i = 0; i < dim; i++) {
-		result += u1[i] * u2[i];
+	distance_sum = normalized_sum = difference_sum = 0;
+	for (uint k = 0; k < count; k++) {
+		distance_sum += sqrt(distance[k]);
+		normalized_sum += normalized_max[k];
+		difference_sum += difference_max[k];
 	}
-	return result;
+}
 }
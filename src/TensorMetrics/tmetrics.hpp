@@ -1,63 +1,77 @@
 #ifndef _TMETRICS_HPP
 #define _TMETRICS_HPP
 
-#include <list>
 #include <string>
 #include <vector>
-#include <exception>
-#include <fstream>
-#include <chrono>
+#include <cstdint>
+#include "../Tensor/tensor.hpp"
 
+namespace tmetrics
+{
 typedef unsigned int uint;
 
 struct ModeDependentMetrics {
-	ModeDependentMetrics(double bandwidth, double density)
-		: fiber_bandwidth(bandwidth), fiber_density(density) { }
-	double fiber_bandwidth;
+	ModeDependentMetrics()
+		: fiber_bandwidth(0), fiber_density(0), fiber_count(0), nnz_count(0), build_ms(0), metric_ms(0) { }
+	double fiber_bandwidth; // avg. over the fibers of the mode
 	double fiber_density;
+	uint64_t fiber_count;
+	uint64_t nnz_count; // nonzeros covered by the fibers
+	double build_ms; // building the CSF tree of the mode
+	double metric_ms;
 };
 
+struct ModeIndependentMetrics {
+	ModeIndependentMetrics()
+		: distance_to_diagonal(0), normalized_pairwise_difference(0), pairwise_difference(0), metric_ms(0) { }
+	double distance_to_diagonal; // avg. over all nonzeros
+	double normalized_pairwise_difference;
+	double pairwise_difference;
+	double metric_ms;
+};
+
+// Computes the ordering quality metrics of a tensor, nothing is printed
 class Tmetrics {
 public:
-	Tmetrics(const std::string & in_file, bool no_values = false, bool verbose = false);
-
-	void mode_dependent_metrics(); // ALL fiber bandwidth | fiber density metrics for all modes | fiber occupation std. dev.
-	void mode_independent_metrics() const; // For all NNZ, avg. distance to diag. | pairwise diff. avg | normalized pairwise diff.
-private:
-	struct Coordinate {
-		Coordinate(const std::vector<uint> & vec) : coor(vec) { }
-		std::vector<uint> coor;
-	};
+	// Throws tensor::TensorException when the file cannot be read
+	Tmetrics(const std::string & in_file, bool no_values = false, uint num_threads = 0);
+	// Uses the tensor in place, it must outlive the Tmetrics object
+	explicit Tmetrics(const tensor::CooTensor & coo, uint num_threads = 0);
 
-	struct Comparator {
-		Comparator(uint mode)
-			: mode(mode) { }
+	// Every following metric is the one of the tensor relabeled by <mode_tables>: coordinate c of mode m becomes
+	// mode_tables[m][c], as relabel writes it. Coordinates are relabeled as they are read, the relabeled tensor
+	// is never built. An empty relabeling brings back the natural ordering.
+	// Throws tensor::TensorException when the tables don't cover the coordinates
+	void set_relabeling(const std::vector< std::vector<uint> > & mode_tables);
 
-		bool operator() (const Coordinate & lhs, const Coordinate & rhs) const;
+	uint64_t nnz() const { return coo.nnz(); }
+	const std::vector<uint> & dimensions() const { return diagonal; } // largest coordinate of each mode
 
-		const uint mode;
-	};
+	std::vector<ModeDependentMetrics> mode_dependent_metrics() const; // fiber bandwidth & density of every mode
+	ModeIndependentMetrics mode_independent_metrics() const; // For all NNZ, avg. distance to diag. | pairwise diff. avg | normalized pairwise diff.
+private:
+	Tmetrics(const Tmetrics &);
+	Tmetrics & operator=(const Tmetrics &);
 
 	// Member variables
-	std::list<Coordinate> coords;
+	tensor::CooTensor owned_tensor; // empty unless the tensor was read from a file
+	const tensor::CooTensor & coo;
+	std::vector< std::vector<uint> > relabeling; // empty for the natural ordering
 	std::vector<uint> diagonal; // for mode independent metrics
-	bool no_values; // CLI option
-	bool verbose; // CLI option
+	uint num_threads; // CLI option
 	double diagonal_self_dot_product;
 
-	mutable std::list<uint> fiber_indices; // stores the index of coords for which a new fiber begins
-	mutable uint fiber_count;
+	void compute_diagonal();
 
 	// Mode dependent metrics
-	ModeDependentMetrics fiber_metrics(uint mode); // for one mode, returns the avg. fiber bandwidth & density
+	ModeDependentMetrics fiber_metrics(uint mode, uint num_threads) const; // for one mode, returns the avg. fiber bandwidth & density
 
 	// Mode independent metrics
-	std::pair<uint, double> pairwise_difference(const std::list<Coordinate>::const_iterator &) const; // for a given coordinate, returns the max pairwise difference
-	double distance_to_diagonal(const std::list<Coordinate>::const_iterator &) const;
-
-	// Utilities
-	void createFibers(uint mode);
-	uint dot_product(const std::vector<uint> & u1, const std::vector<uint> & u2) const;
+	// for the nonzeros [begin, begin + count), adds up the distances to the diagonal and the max pairwise differences
+	// [<scratch> holds a block of every mode, used when the tensor is relabeled]
+	void independent_block(uint64_t begin, uint count, uint * scratch,
+		double & distance_sum, double & normalized_sum, double & difference_sum) const;
 };
+}
 
-#endif
\ No newline at end of file
+#endif
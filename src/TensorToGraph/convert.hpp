@@ -4,44 +4,45 @@
 #include <string>
 #include <exception>
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include "../Tensor/tensor.hpp"
+#include "../Graph/csr_graph.hpp"
 
 namespace convert
 {
 typedef unsigned int uint;
 
-struct Edge {
-	Edge() { weight = 0; vertex1 = 0; vertex2 = 0; }
-	Edge(uint v1, uint v2, uint weight) : vertex1(v1), vertex2(v2), weight(weight) { }
-	uint vertex1;
-	uint vertex2;
-	uint weight;
-
-	bool operator==(const Edge & rhs) const {
-		if (this->vertex1 == rhs.vertex1 && this->vertex2 == rhs.vertex2) {
-			return true;
-		}
-		return false;
-	}
-};
+// Builds the symmetric k-partite graph of <coo> straight from its nonzeros: two vertices are adjacent when
+// a nonzero holds both of them, the weight of the edge is the number of such nonzeros. Vertex v of mode m
+// has the id (mode_widths[0] + ... + mode_widths[m - 1]) + v, every row lists its neighbors in increasing order.
+// The nonzeros are grouped once per mode by its coordinate, two passes over the groups count and then write
+// the distinct neighbors in the later modes. The symmetric rows are assembled from these [no edge list is materialized]
+graph::CSRGraph build_graph(const tensor::CooTensor & coo, const uint * mode_widths, uint num_threads = 0);
 
 class Convert {
 public:
-	Convert(const std::string filename, uint dimension, uint num_vertices, uint * mode_widths, bool verbose = false);
+	Convert(const std::string filename, uint dimension, uint64_t nnz, uint * mode_widths, bool verbose = false,
+		uint num_threads = 0);
+	Convert(const tensor::CooTensor & coo, uint * mode_widths, bool verbose = false, uint num_threads = 0);
 
 	void write_graph(const std::string & output_file) const;
+	// The graph of write_graph as a binary CSR graph file [see graph::GraphBinaryHeader]
+	void write_binary_graph(const std::string & output_file) const;
+	// Hands over the k-partite graph write_graph writes [vertex ids include the mode offsets],
+	// nothing can be written afterwards
+	graph::CSRGraph release_graph();
 private:
 	// Member variables
-	Edge ** pairCoordinates;
+	graph::CSRGraph kpartite;
 	bool verbose;
 	uint * mode_widths;
-	uint nnz;
+	uint64_t nnz;
 	uint dimension;
-
-	uint num_output_edges;
+	uint num_threads;
 
 	// Private Mutators
-	void processCoordinates();
-	static bool compareEdge(const Edge & lhs, const Edge & rhs);
+	void processCoordinates(const tensor::CooTensor & coo);
 };
 
 // =====================
@@ -51,8 +52,8 @@ private:
 class ConvertException : public std::exception {
 public:
 	ConvertException(const char * msg) : msg(msg) { }
-	void what() {
-		std::cout << msg << std::endl;
+	const char * what() const noexcept {
+		return msg;
 	}
 private:
 	const char * msg;
@@ -10,7 +10,7 @@ namespace convert
 {
 
 void usage() {
-	cout << "Usage: PURE TENSOR -nnz NNZ -n DIMENSION WIDTH1 WIDTH2... -[OPTIONS...]" << endl;
+	cout << "Usage: PURE TENSOR [-nnz NNZ] -n DIMENSION WIDTH1 WIDTH2... -[OPTIONS...]" << endl;
 }
 
 void help() {
@@ -19,7 +19,9 @@ void help() {
 	usage();
 	cout << "Avaiable options:" << endl
 		<< "\t-o FILE\t\t sets the name of the output file" << endl
-		<< "\t-v \t\t verbose mode" << endl;
+		<< "\t-binary \t writes the binary CSR graph file rabbit & rcm map into memory [before -n]" << endl
+		<< "\t-v \t\t verbose mode" << endl
+		<< "\t-threads N\t number of threads building the graph rows [before -n]" << endl;
 }
 
 int tensorToGraphMain(int argc, char * argv[]) {
@@ -31,7 +33,7 @@ int tensorToGraphMain(int argc, char * argv[]) {
 		arguments[i] = string(argv[i]);
 	}
 
-	bool verbose = false;
+	bool verbose = false, binary = false;
 
 	if (find(begin(arguments), end(arguments), "--help") != end(arguments)) {
 		help();
@@ -48,7 +50,8 @@ int tensorToGraphMain(int argc, char * argv[]) {
 	string outfile = "converted_graph.txt";
 	uint dimension = 0;
 	uint * mode_widths;
-	uint nnz = 0;
+	uint64_t nnz = 0;
+	uint num_threads = 0;
 	uint num_widths_read = 0;
 	bool dimensions_provided = false;
 	for (int i = 2; i < argc; i++) {
@@ -56,6 +59,9 @@ int tensorToGraphMain(int argc, char * argv[]) {
 		if (arg_i == "-v") {
 			verbose = true;
 		}
+		else if (arg_i == "-binary") {
+			binary = true;
+		}
 		else if (arg_i == "-o") {
 			if (i + 1 < argc && argv[i + 1][0] != '-') {
 				outfile = argv[i + 1];
@@ -87,6 +93,16 @@ int tensorToGraphMain(int argc, char * argv[]) {
 				exit(1);
 			}
 		}
+		else if (arg_i == "-threads") {
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				num_threads = atoi(argv[i + 1]);
+				i++;
+			}
+			else {
+				cerr << "Number of threads must be provided with -threads option!" << endl;
+				exit(1);
+			}
+		}
 		else if (arg_i == "-nnz") {
 			if (i + 1 < argc) {
 			  istringstream iss(argv[i + 1]);
@@ -114,11 +130,24 @@ int tensorToGraphMain(int argc, char * argv[]) {
 	}
 
 	try {
-	  convert::Convert conv_obj(infile, dimension, nnz, mode_widths, verbose);
-		conv_obj.write_graph(outfile);
+	  convert::Convert conv_obj(infile, dimension, nnz, mode_widths, verbose, num_threads);
+		if (binary) {
+			conv_obj.write_binary_graph(outfile);
+		}
+		else {
+			conv_obj.write_graph(outfile);
+		}
 	}
 	catch (ConvertException & exc) {
-		exc.what();
+		cout << exc.what() << endl;
+	}
+	catch (graph::GraphFileException & exc) {
+		cerr << "Cannot write the graph file " << outfile << ": " << exc.what() << endl;
+		exit(1);
+	}
+	catch (tensor::TensorException & exc) {
+		cerr << "Cannot read the tensor file " << infile << ": " << exc.what() << endl;
+		exit(1);
 	}
 
 	cout << "************************************" << endl;
@@ -1,56 +1,69 @@
 import matplotlib.pyplot as plt
+import json
 import os
 
-#prepare the filenames to read
-dimension = int(input("Enter the dimension of the tensor [required for file parsing]: "))
-filenames = list()
-for i in range(dimension):
-    for j in range(dimension + 1)[i + 1:]:
-        filenames.append('mode_' + str(i) + '_' + str(j) + '.metric')
+# Every report is written by: PURE metrics TENSOR -format json -o REPORT.json
+# A file written with -p holds an array with one report per ordering, its reports keep their order
+# The reports of a folder are plotted in the order of their file names
+def read_reports(folder):
+    filenames = sorted(f for f in os.listdir(folder) if f.endswith('.json'))
+    reports = list()
+    for filename in filenames:
+        with open('./' + folder + '/' + filename) as fo:
+            report = json.load(fo)
+        if isinstance(report, list):
+            reports.extend(report)
+        else:
+            reports.append(report)
+    return filenames, reports
 
 def plot_data_in_folder(folder, output_fname):
-    for filename in filenames:
-        fo = open('./' + folder + '/' + filename)
-        
-        distance_metrics = []
-        normalized_pair_metrics = []
-        pair_metrics = []
-
-        line = fo.readline()
-        while (line != ""):
-
-            distance_metric, normalized_pairwise, pairwise = map(float, line.split())
-
-            distance_metrics.append(distance_metric)
-            normalized_pair_metrics.append(normalized_pairwise)
-            pair_metrics.append(pairwise)
-
-            line = fo.readline()
-
-            
-        f, (dist_plot, npair_plot, pair_plot) = plt.subplots(3, sharex = True)
-        # values gathered, prepare the graphs
-        # 1 - Plot the distance metric graph
-        
-        dist_plot.set_title(filename + ' distance')
-        dist_plot.plot(distance_metrics, 'green')
-        
-        # 2 - Plot the normalized pairwise metric
-        npair_plot.set_title(filename + ' norm pairwise')
-        npair_plot.plot(normalized_pair_metrics, 'red')
-        
-        # 3 - Plot the pairwise metrics
-        pair_plot.set_title(filename + ' pairwise')
-        pair_plot.plot(pair_metrics, 'orange')
-        
+    filenames, reports = read_reports(folder)
+    if not reports:
+        print ('No metric reports in ' + folder)
+        return
+    if not os.path.exists(output_fname):
+        os.makedirs(output_fname)
+
+    # 1 - Mode independent metrics
+    distance_metrics = [r['mode_independent']['distance_to_diagonal'] for r in reports]
+    normalized_pair_metrics = [r['mode_independent']['normalized_pairwise_difference'] for r in reports]
+    pair_metrics = [r['mode_independent']['pairwise_difference'] for r in reports]
+
+    f, (dist_plot, npair_plot, pair_plot) = plt.subplots(3, sharex = True)
+    dist_plot.set_title(folder + ' distance')
+    dist_plot.plot(distance_metrics, 'green')
+
+    npair_plot.set_title(folder + ' norm pairwise')
+    npair_plot.plot(normalized_pair_metrics, 'red')
+
+    pair_plot.set_title(folder + ' pairwise')
+    pair_plot.plot(pair_metrics, 'orange')
+
+    f.subplots_adjust(hspace=1)
+    plt.setp([a.get_xticklabels() for a in f.axes[:-1]], visible=False)
+    plt.savefig('./' + output_fname + '/mode_independent.png')
+    plt.close()
+    print ('Plotted mode independent metrics of ' + folder)
+
+    # 2 - Fiber metrics, one figure per mode
+    dimension = len(reports[0]['modes'])
+    for mode in range(dimension):
+        bandwidths = [r['modes'][mode]['fiber_bandwidth'] for r in reports]
+        densities = [r['modes'][mode]['fiber_density'] for r in reports]
+
+        f, (bandwidth_plot, density_plot) = plt.subplots(2, sharex = True)
+        bandwidth_plot.set_title('mode ' + str(mode) + ' fiber bandwidth')
+        bandwidth_plot.plot(bandwidths, 'blue')
+
+        density_plot.set_title('mode ' + str(mode) + ' fiber density')
+        density_plot.plot(densities, 'purple')
+
         f.subplots_adjust(hspace=1)
         plt.setp([a.get_xticklabels() for a in f.axes[:-1]], visible=False)
-        if not os.path.exists(output_fname):
-            os.makedirs(output_fname)
-        plt.savefig('./' + output_fname + '/' + filename + ".png")
+        plt.savefig('./' + output_fname + '/mode_' + str(mode) + '.png')
         plt.close()
-        
-        print ('Plotted ' + filename)
+        print ('Plotted fiber metrics of mode ' + str(mode))
 
 plot_data_in_folder('ordered_metrics', 'ordered_metric_images')
-plot_data_in_folder('ordered_metrics', 'natural_metric_images')
\ No newline at end of file
+plot_data_in_folder('natural_metrics', 'natural_metric_images')
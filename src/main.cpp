@@ -4,8 +4,15 @@
 #include "./RandomTensor/rand_tns.cpp"
 #include "./TensorToGraph/main.cpp"
 #include "./RelabelTensor/main.cpp"
+#include "./Tensor/main.cpp"
+#include "./Reorder/main.cpp"
+#include "./TensorMetrics/main.cpp"
+#include "./Benchmark/main.cpp"
+#include "./HypergraphOrder/main.cpp"
+#include "./LexiOrder/main.cpp"
 #include <vector>
 #include <string>
+#include <cstring>
 #include <algorithm>
 using namespace std;
 
@@ -15,8 +22,15 @@ void commands() {
        << "\trandom_graph\tcreate a random graph with specified edge and vertex count" << endl
        << "\tconvert\t\tconvert a compatible tensor file into an k-partite graph" << endl
        << "\trelabel\t\trelabel a tensor file with the provided permutation file" << endl
+       << "\tpack\t\tconvert a tensor file into the binary tensor format" << endl
+       << "\tunpack\t\tconvert a binary tensor file back into a tensor file" << endl
        << "\trcm\t\tcompute a RCM permutation of a supplied graph" << endl
-       << "\trabbit\t\tcompute a rabbit ordering permutation of a supplied graph" << endl;
+       << "\trabbit\t\tcompute a rabbit ordering permutation of a supplied graph" << endl
+       << "\thypergraph\tcompute a recursive bisection permutation of a tensor's hypergraph" << endl
+       << "\tlexi\t\tcompute a Lexi-Order permutation of a tensor" << endl
+       << "\treorder\t\tconvert, order & relabel a tensor in a single process" << endl
+       << "\tmetrics\t\tcompute the ordering quality metrics of a tensor" << endl
+       << "\tbench\t\ttime MTTKRP & TTV on a tensor in its natural and permuted labelings" << endl;
 }
 
 void helpGeneral() {
@@ -49,10 +63,24 @@ int main(int argc, char * argv[]) {
     convert::tensorToGraphMain(argc - 1, &argv[1]);
   else if (strcmp(application, "relabel") == 0)
     relabel::relabelMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "pack") == 0)
+    tensor::packMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "unpack") == 0)
+    tensor::unpackMain(argc - 1, &argv[1]);
   else if (strcmp(application,"rcm") == 0)
     rcm::RCMmain(argc - 1, &argv[1]);
   else if (strcmp(application, "rabbit") == 0)
     rabbit::rabbitMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "hypergraph") == 0)
+    hypergraph::hypergraphMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "lexi") == 0)
+    lexi::lexiMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "reorder") == 0)
+    reorder::reorderMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "metrics") == 0)
+    tmetrics::metricsMain(argc - 1, &argv[1]);
+  else if (strcmp(application, "bench") == 0)
+    bench::benchMain(argc - 1, &argv[1]);
   else {
     cout << "Unknown command " << application << endl;
     errorMessage();